@@ -10,6 +10,21 @@
 #include "acmp.h"
 #include "watchdog.h"
 #include "int_vect.h"
+#include "fast_isr.h"
+#include "isr_chain.h"
 #include "eeprom.h"
+#include "softtimer.h"
+#include "startup.h"
+#include "ambient.h"
+#include "suart.h"
+#include "stack.h"
+#include "prof.h"
+#include "timing.h"
+#include "sbus.h"
+#include "ladder.h"
+#include "config.h"
+#include "packed.h"
+#include "vcc.h"
+#include "fsm.h"
 
 
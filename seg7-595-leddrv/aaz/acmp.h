@@ -53,7 +53,7 @@ namespace aaz {
 		}
 		
 		constexpr uint8_t calc_acsr_cfg(acmp_trigger tg, bool interrupt_enable, bool ref_bandgap, bool enable) {
-			return static_cast<uint8_t>(tg) | ((interrupt_enable) ? _BV(ACIE) : 0) | ((ref_bandgap) ? _BV(ACBG) : 0) | (disable ? _BV(ACD) : 0);
+			return static_cast<uint8_t>(tg) | ((interrupt_enable) ? _BV(ACIE) : 0) | ((ref_bandgap) ? _BV(ACBG) : 0) | ((enable) ? 0 : _BV(ACD));
 		}
 		
 		//ACSR = Analog Comparator Control & Status Register
@@ -61,5 +61,10 @@ namespace aaz {
 		inline void set_acsr(acmp_trigger tg, bool interrupt_enable = true, bool ref_bandgap = false, bool enable = true) {
 			ACSR = calc_acsr_cfg(tg, interrupt_enable, ref_bandgap, enable);
 		}
+		
+		//comparator output, true when positive input (AIN0 or bandgap) is higher than negative input.
+		inline bool output() {
+			return bit_is_set(ACSR, ACO);
+		}
 	}
 }
\ No newline at end of file
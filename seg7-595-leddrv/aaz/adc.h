@@ -2,6 +2,7 @@
 #pragma once
 
 #include "io_x.h"
+#include "power.h"
 
 
 namespace aaz {
@@ -38,8 +39,18 @@ namespace aaz {
 			pb2,         //ADC1
 			pb4,         //ADC2
 			pb3,         //ADC3
+#if defined(MUX3)
+			bandgap = 0x0c,    //internal 1.1V reference, ATtiny25/45/85, the ATtiny13A mux reaches ADC0 - ADC3 only.
+#endif
 		};
 
+#ifdef F_CPU
+		//smallest divider which keeps the ADC clock at max_hz or below for F_CPU, div_128 at most.
+		constexpr adc_clkdiv calc_clkdiv(uint32_t max_hz, uint8_t log2 = 1) {
+			return (log2 == 7 || (F_CPU >> log2) <= max_hz) ? static_cast<adc_clkdiv>(log2) : calc_clkdiv(max_hz, log2 + 1);
+		}
+#endif
+
 		inline void enable() {
 			ADCSRA |= _BV(ADEN);
 		}
@@ -137,6 +148,83 @@ namespace aaz {
 			ADCSRA |= _BV(ADSC);
 		}
 		
+		inline bool now_converting() {
+			return static_cast<bool>(ADCSRA & _BV(ADSC));
+		}
+		
+		//start a conversion and poll until completed, cpu keeps running.
+		inline void convert_busy() {
+			start();
+			while(now_converting());
+		}
+		
+		/* convert in ADC Noise Reduction sleep mode, cpu and clk_io (timer0 included) halt
+		*  while converting, so bit-banging and port switching noise stay away from the conversion.
+		*  the conversion is started right before entering the mode, sample and hold happens after the cpu sleeps.
+		*
+		*  requires adc enabled, adc interrupt enabled with an ISR(iv_adc) defined
+		*  (EMPTY_INTERRUPT is fine) and global interrupt enabled, otherwise the cpu never wakes up.
+		*  other wake-up sources (watchdog, int0, pin change) only put the cpu back to sleep until completed.
+		*  sleep mode is left as adc_noise_reduction, set it again before next idle sleep.
+		*/
+		inline void convert_quiet() {
+			set_sleep_mode_as(sleep_mode_enum::adc_noise_reduction);
+			cli();
+			start();
+			do {
+				sei_and_sleep();
+				cli();
+			} while(now_converting());
+			sei();
+		}
+		
+		//8-bit result, use with left aligned result (ADLAR set).
+		inline uint8_t result8() {
+			return ADCH;
+		}
+		
+		/* 8-bit quiet reading with oversampling, average of 2^Log2N conversions.
+		*  Log2N = 0 for a single conversion when latency matters,
+		*  higher Log2N for precision, each doubles the time spent (around 50us per conversion at 300kHz ADC clock).
+		*/
+		template<uint8_t Log2N = 0>
+		uint8_t read8_quiet() {
+			static_assert(Log2N < 8, "at most 128 conversions can be averaged.");
+			uint16_t sum = 0;
+			uint8_t n = 1 << Log2N;
+			do {
+				convert_quiet();
+				sum += result8();
+			} while(--n);
+			return static_cast<uint8_t>(sum >> Log2N);
+		}
+		
+		//same as read8_quiet(), cpu and timer0 keep running while converting.
+		template<uint8_t Log2N = 0>
+		uint8_t read8_busy() {
+			static_assert(Log2N < 8, "at most 128 conversions can be averaged.");
+			uint16_t sum = 0;
+			uint8_t n = 1 << Log2N;
+			do {
+				convert_busy();
+				sum += result8();
+			} while(--n);
+			return static_cast<uint8_t>(sum >> Log2N);
+		}
+		
+#if defined(MUX3)
+		/* supply voltage reading, see aaz/vcc.h, requires ADMUX set to bandgap with Vcc reference
+		*  (calc_admux_cfg(adc_mux::bandgap)) and adc enabled.
+		*  the bandgap settles after it is selected, the first conversion is dropped for that.
+		*  busy conversions, no ISR(iv_adc) needed, keep adc interrupt disabled if there is none.
+		*/
+		template<uint8_t Log2N = 0>
+		uint8_t read_vcc8() {
+			convert_busy();
+			return read8_busy<Log2N>();
+		}
+#endif
+		
 	}
 }
 
@@ -0,0 +1,90 @@
+
+#pragma once
+
+extern "C" {
+	#include <stdint.h>
+}
+
+
+/////////////Ambient Sensing Util
+
+/* fixed point filtering and level selection for slowly changing sensor readings (light, supply voltage...),
+*  no register access, so it compiles on host as well.
+*/
+
+namespace aaz {
+	namespace ambient {
+		/* first order low pass filter, y += (x - y) / 2^Shift.
+		*  y is kept with Shift fraction bits, thus no precision lost at small steps.
+		*  starts from 0, step response reaches 63% after 2^Shift updates.
+		*/
+		template<uint8_t Shift>
+		class lpf {
+		public:
+			static_assert(Shift <= 8, "filter state is 16-bit, at most 8 fraction bits.");
+
+			uint8_t update(uint8_t x) {
+				acc = acc - (acc >> Shift) + x;
+				return value();
+			}
+
+			uint8_t value() const {
+				return static_cast<uint8_t>(acc >> Shift);
+			}
+
+			void reset(uint8_t x) {
+				acc = static_cast<uint16_t>(x) << Shift;
+			}
+
+		private:
+			uint16_t acc;
+		};
+
+		constexpr bool ascending() {
+			return true;
+		}
+
+		constexpr bool ascending(uint8_t) {
+			return true;
+		}
+
+		template<typename... Ts>
+		constexpr bool ascending(uint8_t a, uint8_t b, Ts... rest) {
+			return a < b && ascending(b, rest...);
+		}
+
+		/* maps a reading to one of sizeof...(Th) + 1 levels, level k covers [Th[k-1], Th[k]).
+		*  proportional hysteresis: going up from level k needs x >= Th[k] + Th[k] / 2^HystShift,
+		*  going down needs x < Th[k-1] - Th[k-1] / 2^HystShift, one code at least for small thresholds.
+		*  moves at most one level per call, so a single wild reading only costs one step.
+		*/
+		template<uint8_t HystShift, uint8_t... Th>
+		struct curve {
+			static_assert(ascending(0, Th...), "thresholds must be ascending, and above 0 for the hysteresis below them.");
+
+			static constexpr uint8_t levels = sizeof...(Th) + 1;
+			static constexpr uint8_t th[sizeof...(Th)] = {Th...};
+
+			static constexpr uint8_t margin(uint8_t t) {
+				return (t >> HystShift) ? (t >> HystShift) : 1;
+			}
+
+			static uint8_t next(uint8_t level, uint8_t x) {
+				if(level < levels - 1) {
+					uint16_t up = th[level] + margin(th[level]);
+					if(x >= up)
+						return level + 1;
+				}
+				if(level > 0) {
+					uint8_t down = th[level - 1] - margin(th[level - 1]);
+					if(x < down)
+						return level - 1;
+				}
+				return level;
+			}
+		};
+
+		template<uint8_t HystShift, uint8_t... Th>
+		constexpr uint8_t curve<HystShift, Th...>::th[sizeof...(Th)];
+	}
+}
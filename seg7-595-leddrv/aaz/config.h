@@ -0,0 +1,124 @@
+
+#pragma once
+
+#include "io_x.h"
+#include "adc.h"
+#include "timer0.h"
+#include "watchdog.h"
+
+extern "C" {
+	#include <avr/interrupt.h>
+}
+
+
+/////////////Peripheral Configuration Bundles
+
+/* the whole register state of ADC, timer0, watchdog and power reduction in an operating mode,
+*  described once as a constexpr value instead of a sequence of read-modify-write calls.
+*
+*  apply<To, From>() compares both states at compile time and writes only the registers which differ,
+*  each with a single store, in an order that is safe for the hardware:
+*      PRR bits cleared first (a module is clocked again before it is configured),
+*      ADMUX, ADCSRA, TCCR0A, TCCR0B, TIMSK0,
+*      PRR bits set last (ADC is disabled before it is shut down),
+*      WDTCR through the WDCE timed sequence, with interrupts held off for the 4 cycles.
+*  identical modes compile to nothing.
+*
+* NORMAL USEAGE:
+*
+* constexpr aaz::cfg::mode run_mode = aaz::cfg::reset_state
+*     .with_adc(adc::adc_mux::pb3, adc::adc_clkdiv::div_4, true)
+*     .with_timer0(t0::timer0_clkdiv::div_8, t0::calc_timer0_intmask(true, false, false));
+* constexpr aaz::cfg::mode sleep_mode = run_mode
+*     .without_adc()
+*     .with_watchdog(wdt::wdt_mode::interrupt, wdt::wdt_prescaler::cycle_1s);
+*
+* aaz::cfg::apply<run_mode>();                //from reset, at startup
+* aaz::cfg::apply<sleep_mode, run_mode>();    //ADCSRA, PRR and WDTCR only
+*
+* modes must be namespace scope constexpr objects, they are template arguments.
+* bits owned by drivers at run time (OCIE0B of aaz::suart, OCR0x) are not part of a mode.
+*/
+
+namespace aaz {
+	namespace cfg {
+		struct mode {
+			uint8_t prr;
+			uint8_t admux;
+			uint8_t adcsra;
+			uint8_t tccr0a;
+			uint8_t tccr0b;
+			uint8_t timsk0;
+			uint8_t wdtcr;
+
+			//ADC on, single conversion.
+			constexpr mode with_adc(adc::adc_mux mx, adc::adc_clkdiv ckdv, bool interrupt_enable,
+			                        bool left_align = true, bool internal_aref = false) const {
+				return {static_cast<uint8_t>(prr & ~_BV(PRADC)), adc::calc_admux_cfg(mx, left_align, internal_aref),
+				        adc::calc_adcsra_cfg(true, ckdv, interrupt_enable, false), tccr0a, tccr0b, timsk0, wdtcr};
+			}
+
+			//ADC disabled, ADMUX is kept.
+			//the analog comparator needs the ADC clock, keep shut_down false while it is used.
+			constexpr mode without_adc(bool shut_down = true) const {
+				return {static_cast<uint8_t>(shut_down ? (prr | _BV(PRADC)) : (prr & ~_BV(PRADC))), admux, 0x00,
+				        tccr0a, tccr0b, timsk0, wdtcr};
+			}
+
+			//timer0 counting in normal mode.
+			constexpr mode with_timer0(t0::timer0_clkdiv ckdv, uint8_t intmask) const {
+				return {static_cast<uint8_t>(prr & ~_BV(PRTIM0)), admux, adcsra,
+				        0x00, low_half(static_cast<uint8_t>(ckdv)), intmask, wdtcr};
+			}
+
+			constexpr mode without_timer0() const {
+				return {static_cast<uint8_t>(prr | _BV(PRTIM0)), admux, adcsra, 0x00, 0x00, 0x00, wdtcr};
+			}
+
+			constexpr mode with_watchdog(wdt::wdt_mode m, wdt::wdt_prescaler p) const {
+				return {prr, admux, adcsra, tccr0a, tccr0b, timsk0,
+				        static_cast<uint8_t>(static_cast<uint8_t>(m) | static_cast<uint8_t>(p))};
+			}
+
+			constexpr mode without_watchdog() const {
+				return {prr, admux, adcsra, tccr0a, tccr0b, timsk0, 0x00};
+			}
+		};
+
+		/* register values after reset.
+		*  WDE is forced on after a watchdog reset until WDRF is cleared, so WDTCR is taken as WDE here,
+		*  a mode built from it keeps WDE until without_watchdog() or with_watchdog() is called,
+		*  and only then does apply() from reset write the watchdog (clear WDRF before that).
+		*/
+		constexpr mode reset_state = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, _BV(WDE)};
+
+		template<const mode &To, const mode &From = reset_state>
+		inline void apply() {
+			constexpr uint8_t prr_wake = From.prr & To.prr;
+
+			if(prr_wake != From.prr)
+				PRR = prr_wake;
+			if(To.admux != From.admux)
+				ADMUX = To.admux;
+			if(To.adcsra != From.adcsra)
+				ADCSRA = To.adcsra;
+			if(To.tccr0a != From.tccr0a)
+				TCCR0A = To.tccr0a;
+			if(To.tccr0b != From.tccr0b)
+				TCCR0B = To.tccr0b;
+			if(To.timsk0 != From.timsk0)
+				TIMSK0 = To.timsk0;
+			if(To.prr != prr_wake)
+				PRR = To.prr;
+
+			if(To.wdtcr != From.wdtcr) {
+				uint8_t sreg = SREG;
+				cli();
+				wdt::reset();
+				WDTCR = _BV(WDCE) | _BV(WDE);    //start timed sequence
+				WDTCR = To.wdtcr;
+				SREG = sreg;
+			}
+		}
+	}
+}
@@ -4,6 +4,7 @@
 
 extern "C" {
 	#include <avr/eeprom.h>
+	#include <avr/interrupt.h>
 }
 
 namespace aaz {
@@ -36,13 +37,19 @@ namespace aaz {
 			return static_cast<bool>(EECR & _BV(EEPE));
 		}
 		
-		//read a byte from specific address, 
+		//read a byte from specific address, cpu halts 4 cycles for it.
 		//eeprom busy check may be needed prior.
 		inline uint8_t read_at(uint8_t addr) {
 			EEARL = addr;
+			EECR |= _BV(EERE);
 			return EEDR;
 		}
 		
+		//little endian word.
+		inline uint16_t read16_at(uint8_t addr) {
+			return read_at(addr) | (static_cast<uint16_t>(read_at(addr + 1)) << 8);
+		}
+		
 		//void read_duoble_byte_at(uint8_t addr, uint16_t &out_ptr) {
 			//uint8_t * const tmp_ptr = reinterpret_cast<uint8_t*>(&out_ptr);
 			//*(tmp_ptr) = read_at(addr);
@@ -62,9 +69,14 @@ namespace aaz {
 		//request for a eeprom write operation at a specified address.
 		//poll EEPE or use EEPROM ready interrupt to detect write completion.
 		//eeprom busy check may be needed prior.
+		//EEPE must follow EEMPE within 4 cycles, setting both at once is ignored, and an interrupt between them too.
 		void write_request_at(uint8_t addr) {
 			EEARL = addr;
-			EECR |= (_BV(EEMPE) | _BV(EEPE));
+			uint8_t sreg = SREG;
+			cli();
+			EECR |= _BV(EEMPE);
+			EECR |= _BV(EEPE);
+			SREG = sreg;
 		}
 		
 		//read byte from eeprom data register.
@@ -77,6 +89,61 @@ namespace aaz {
 			EEDR = val;
 		}
 		
+		/* wear aware write, never waits: false if a former write is still going on, nothing done then.
+		*  a byte already holding val is not written at all,
+		*  a byte whose bits only go from 1 to 0 is programmed without erase (1.8ms instead of 3.4ms, no erase cycle).
+		*/
+		bool update_at(uint8_t addr, uint8_t val) {
+			if(now_busy())
+				return false;
+			uint8_t old = read_at(addr);
+			if(old == val)
+				return true;
+			set_write_mode(((old & val) == val) ? eeprom_write_mode::write_only : eeprom_write_mode::erase_and_write);
+			put_val(val);
+			write_request_at(addr);
+			return true;
+		}
+		
+		/* 16-bit counter spread over Slots words at Base, each new value goes to the next slot,
+		*  so a cell is written once per Slots updates, Slots times the endurance of a single word.
+		*  erased slots read 0xffff. write the low byte first: values from 0xff00 are taken as a torn write
+		*  into an erased slot and skipped, a torn write into a used slot reads lower and is skipped by the maximum.
+		*
+		* typedef aaz::eep::ring16<0x10, 8> hours;    //16 bytes at 0x10
+		* uint8_t slot;
+		* uint16_t h = hours::latest(slot);
+		* slot = hours::next(slot);                   //then write h + 1 at hours::addr_of(slot)
+		*/
+		template<uint8_t Base, uint8_t Slots>
+		struct ring16 {
+			static_assert(Slots >= 2, "a ring needs 2 slots at least.");
+			
+			static constexpr uint8_t size = 2 * Slots;
+			
+			static constexpr uint8_t addr_of(uint8_t slot) {
+				return Base + 2 * slot;
+			}
+			
+			static constexpr uint8_t next(uint8_t slot) {
+				return (slot + 1 == Slots) ? 0 : slot + 1;
+			}
+			
+			//0 in the last slot when the ring is erased, so next() starts at slot 0.
+			static uint16_t latest(uint8_t &slot_out) {
+				uint16_t v = 0;
+				slot_out = Slots - 1;
+				for(uint8_t i = 0; i != Slots; ++i) {
+					uint16_t x = read16_at(addr_of(i));
+					if(x < 0xff00 && x >= v) {
+						v = x;
+						slot_out = i;
+					}
+				}
+				return v;
+			}
+		};
+		
 		
 	}
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+
+#pragma once
+
+#include "io_x.h"
+
+extern "C" {
+	#include <avr/interrupt.h>
+}
+
+
+/////////////Fast ISR
+
+/* flag bits for naked interrupt handlers, for ISRs that only need to flag an event.
+*
+* a normal ISR touching one volatile byte in RAM saves r0, r1, SREG and a work register:
+*     4 (response) + 2 (vector rjmp) + 10 (prologue) + 5 (lds, subi, sts) + 13 (epilogue, reti) = 34 cycles.
+*
+* a naked ISR setting an io_flag, a single sbi on a I/O bit, SREG untouched:
+*     4 + 2 + 2 (sbi) + 4 (reti) = 12 cycles.
+*
+* the naked ISR itself is put together by AAZ_ISR_COMPOSE_FLAGS (isr_chain.h), nothing but the named bits is written,
+* and the static_asserts below reject operands which would break that.
+* a naked ISR must never contain C code, the compiler would use registers without saving them.
+*/
+
+namespace aaz {
+	namespace isr {
+		//I/O addresses of spare registers for io_flag bits.
+		//_SFR_IO_ADDR() is a pointer cast in avr-libc, not a constant expression, so it can't be a template argument.
+#if defined(__AVR_ATtiny13A__) || defined(__AVR_ATtiny13__) || defined(__AVR_ATtiny25__) || defined(__AVR_ATtiny45__) || defined(__AVR_ATtiny85__)
+		constexpr uint8_t io_pcmsk = 0x15;
+#else
+#	error "I/O address of PCMSK unknown for this part, add it to fast_isr.h."
+#endif
+
+		//a flag bit in I/O space, set / cleared / tested by single sbi / cbi / sbis instructions.
+		//IoAddr is the I/O address (e.g. io_pcmsk), not the memory address.
+		template<uint8_t IoAddr, uint8_t Bit>
+		struct io_flag {
+			static_assert(IoAddr < 0x20, "sbi / cbi only reach I/O address 0x00 - 0x1f.");
+			static_assert(Bit < 8, "bit number out of range.");
+
+			static constexpr uint8_t io_addr = IoAddr;
+			static constexpr uint8_t bit = Bit;
+
+			static inline bool test() {
+				return bit_is_set(_SFR_IO8(IoAddr), Bit);
+			}
+
+			static inline void set() {
+				_SFR_IO8(IoAddr) |= _BV(Bit);
+			}
+
+			static inline void clear() {
+				_SFR_IO8(IoAddr) &= ~_BV(Bit);
+			}
+
+			//as a fragment of aaz::isr::chain (isr_chain.h), the flag is set.
+			static inline void on_irq() {
+				set();
+			}
+
+			static inline __attribute__((always_inline)) void on_naked_irq() {
+				asm volatile("sbi %0, %1" :: "I" (IoAddr), "I" (Bit));
+			}
+		};
+	}
+}
@@ -0,0 +1,155 @@
+
+#pragma once
+
+extern "C" {
+	#include <stdint.h>
+}
+
+#if defined(__AVR__)
+extern "C" {
+	#include <avr/pgmspace.h>
+}
+#	define AAZ_FSM_ROM PROGMEM
+#else
+#	define AAZ_FSM_ROM
+#endif
+
+
+/////////////Table-driven State Machine
+
+/* a state machine written as a constexpr rule (state, event) -> step {action, next state},
+*  expanded at compile time into a flash table of one byte per state and event (action << 4 | next),
+*  so dispatch is one table read, whatever the rule looks like. every step is range checked at compile time.
+*
+*  the rule is plain constexpr C++ with no register access, the same machine runs on host for exhaustive tests
+*  (tools/editfsm.cpp). the caller keeps the state byte and carries out the actions, thus it may sleep between events.
+*
+*  a machine is a type with:
+*      static constexpr uint8_t states, events, actions;    //16 states and 16 actions at most.
+*      static constexpr aaz::fsm::step rule(uint8_t state, uint8_t event);
+*
+* NORMAL USEAGE:
+*
+* typedef aaz::fsm::machine<aaz::fsm::cursor_edit<4>> edit;
+*
+* uint8_t state = edit::rules::first;
+* ...
+* aaz::fsm::step s = edit::at(state, event);
+* state = s.next;
+* switch(s.action) {
+*     case (edit::rules::commit):
+*     ...
+* }
+*/
+
+namespace aaz {
+	namespace fsm {
+		//what an event does in a state, and the state it leads to.
+		struct step {
+			uint8_t action;
+			uint8_t next;
+		};
+
+		namespace detail {
+			template<uint8_t... I>
+			struct indices {};
+
+			template<uint8_t N, uint8_t... I>
+			struct make_indices : make_indices<N - 1, N - 1, I...> {};
+
+			template<uint8_t... I>
+			struct make_indices<0, I...> {
+				typedef indices<I...> type;
+			};
+
+			constexpr uint8_t pack(step s) {
+				return static_cast<uint8_t>(s.action << 4 | s.next);
+			}
+
+			//steps [i, end) lead to a state and an action of the machine.
+			template<typename Rules>
+			constexpr bool in_range(uint8_t i = 0) {
+				return i == Rules::states * Rules::events ||
+				       (Rules::rule(i / Rules::events, i % Rules::events).next < Rules::states &&
+				        Rules::rule(i / Rules::events, i % Rules::events).action < Rules::actions &&
+				        in_range<Rules>(i + 1));
+			}
+
+			//row major, state by state, one byte per event.
+			template<typename Rules, typename Idx>
+			struct table;
+
+			template<typename Rules, uint8_t... I>
+			struct table<Rules, indices<I...>> {
+				static constexpr uint8_t cell[sizeof...(I)] = {pack(Rules::rule(I / Rules::events, I % Rules::events))...};
+			};
+
+			template<typename Rules, uint8_t... I>
+			constexpr uint8_t table<Rules, indices<I...>>::cell[sizeof...(I)] AAZ_FSM_ROM;
+
+			inline uint8_t rom_read(const uint8_t *p) {
+#if defined(__AVR__)
+				return pgm_read_byte(p);
+#else
+				return *p;
+#endif
+			}
+		}
+
+		template<typename Rules>
+		struct machine {
+			typedef Rules rules;
+
+			static_assert(Rules::states >= 1 && Rules::states <= 16, "a step keeps the next state in 4 bits, 16 states at most.");
+			static_assert(Rules::actions >= 1 && Rules::actions <= 16, "a step keeps the action in 4 bits, 16 actions at most.");
+			static_assert(Rules::events >= 1 && Rules::states * Rules::events <= 255, "the table is indexed by a byte.");
+			static_assert(detail::in_range<Rules>(), "a step leads to a state or an action the machine doesn't have.");
+
+			static constexpr uint8_t size = Rules::states * Rules::events;
+
+			typedef detail::table<Rules, typename detail::make_indices<size>::type> table;
+
+			//event must be below Rules::events, nothing is checked at run time.
+			static inline step at(uint8_t state, uint8_t event) {
+				uint8_t c = detail::rom_read(&table::cell[state * Rules::events + event]);
+				return step{static_cast<uint8_t>(c >> 4), static_cast<uint8_t>(c & 0x0f)};
+			}
+		};
+
+		/* a cursor over Positions digits, edited in place with three keys:
+		*  forward moves to the next position and commits past the last one,
+		*  back moves to the previous position and cancels past the first one,
+		*  change runs the change action at the cursor, which stays.
+		*  state n is the cursor at position n, state Positions is done (committed or cancelled), where every event is ignored.
+		*/
+		template<uint8_t Positions>
+		struct cursor_edit {
+			static_assert(Positions >= 1 && Positions <= 15, "one state per position and one for done.");
+
+			static constexpr uint8_t first = 0;
+			static constexpr uint8_t done = Positions;
+			static constexpr uint8_t states = Positions + 1;
+
+			//events
+			static constexpr uint8_t forward = 0;
+			static constexpr uint8_t back = 1;
+			static constexpr uint8_t change = 2;
+			static constexpr uint8_t events = 3;
+
+			//actions
+			static constexpr uint8_t ignore = 0;
+			static constexpr uint8_t move = 1;      //the cursor is at a new position.
+			static constexpr uint8_t apply = 2;     //change the digit at the cursor.
+			static constexpr uint8_t commit = 3;
+			static constexpr uint8_t cancel = 4;
+			static constexpr uint8_t actions = 5;
+
+			static constexpr step rule(uint8_t s, uint8_t e) {
+				return s == done ? step{ignore, done}
+				     : e == forward ? (s == done - 1 ? step{commit, done} : step{move, static_cast<uint8_t>(s + 1)})
+				     : e == back ? (s == first ? step{cancel, done} : step{move, static_cast<uint8_t>(s - 1)})
+				     : step{apply, s};
+			}
+		};
+	}
+}
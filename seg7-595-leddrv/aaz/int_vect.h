@@ -14,7 +14,7 @@ extern "C" {
 
 #define iv_timer0_overflow   (TIM0_OVF_vect)
 #define iv_timer0_oca        (TIM0_COMPA_vect)
-#define iv_timer0_ocb        (TIM0_COMPA_vect)
+#define iv_timer0_ocb        (TIM0_COMPB_vect)
 
 #define iv_int0              (INT0_vect)
 #define iv_pcint0            (PCINT0_vect)
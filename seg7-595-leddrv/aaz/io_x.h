@@ -60,7 +60,7 @@ namespace aaz {
 	
 	template<typename... Ts>
 	inline void clrpins(Ts... pins) {
-		PORTB &= calc_port_cfg(pins...);
+		PORTB &= ~calc_port_cfg(pins...);
 	}		
 
 	template<typename... Ts>
@@ -87,6 +87,13 @@ namespace aaz {
 		DDRB = calc_port_cfg(pins...);
 	}
 	
+	//turn off digital input buffer of analog input pins, saves the current drawn by intermediate voltage.
+	//bit n of DIDR0 belongs to PBn.
+	template <typename... Ts>
+	inline void disable_digital_inputs(Ts... pins) {
+		DIDR0 |= calc_port_cfg(pins...);
+	}
+	
 	
 	constexpr uint8_t high_half(uint8_t b) {
 		return (b & 0xf0) >> 4;
@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include "fast_isr.h"
+
+
+/////////////ISR Composition
+
+/* one ISR body per vector, put together at compile time from handler fragments of the drivers and features using it.
+*  a fragment is a type with 'static void on_irq()', called in list order. the ISR is flattened,
+*  so every fragment is inlined into the one body: no function pointer table, no call, no prologue per fragment.
+*  a feature compiled out drops its fragment with when<false, ...>, nothing else in the list changes.
+*
+*  AAZ_ISR_COMPOSE        a normal ISR, fragments may run any C++ code.
+*  AAZ_ISR_COMPOSE_FLAGS  a naked ISR of io_flag fragments only, one sbi each (2 cycles), SREG untouched,
+*                         a list with all fragments dropped leaves a lone reti.
+*
+* NORMAL USEAGE:
+*
+* struct tx_irq {
+*     static inline void on_irq() {
+*         uart.on_compare();
+*     }
+* };
+*
+* AAZ_ISR_COMPOSE(iv_timer0_ocb, aaz::isr::when<USE_UART, tx_irq>, pwm_irq)
+* AAZ_ISR_COMPOSE_FLAGS(iv_timer0_overflow, tick_flag, aaz::isr::when<USE_LIGHT, light_flag>)
+*
+* a normal ISR still costs its prologue and epilogue with nothing in it,
+* so AAZ_ISR_COMPOSE rejects a list with every fragment dropped: leave the vector out of that build.
+*/
+
+namespace aaz {
+	namespace isr {
+		//nothing, in a normal or a naked ISR.
+		struct none {
+			static inline void on_irq() {}
+			static inline __attribute__((always_inline)) void on_naked_irq() {}
+		};
+
+		//Fragment if Enable, none otherwise, Fragment may be left incomplete when disabled.
+		template<bool Enable, typename Fragment>
+		struct when : Fragment {};
+
+		template<typename Fragment>
+		struct when<false, Fragment> : none {};
+
+		template<typename Fragment>
+		struct dropped {
+			static constexpr bool value = false;
+		};
+
+		template<>
+		struct dropped<none> {
+			static constexpr bool value = true;
+		};
+
+		template<typename Fragment>
+		struct dropped<when<false, Fragment>> {
+			static constexpr bool value = true;
+		};
+
+		template<typename... Fragments>
+		struct chain;
+
+		template<>
+		struct chain<> {
+			static constexpr bool empty = true;
+
+			static inline __attribute__((always_inline)) void run() {}
+			static inline __attribute__((always_inline)) void run_naked() {}
+		};
+
+		template<typename Fragment, typename... Rest>
+		struct chain<Fragment, Rest...> {
+			static constexpr bool empty = dropped<Fragment>::value && chain<Rest...>::empty;
+
+			static inline __attribute__((always_inline)) void run() {
+				Fragment::on_irq();
+				chain<Rest...>::run();
+			}
+
+			//inline asm without registers only, see io_flag::on_naked_irq().
+			static inline __attribute__((always_inline)) void run_naked() {
+				Fragment::on_naked_irq();
+				chain<Rest...>::run_naked();
+			}
+		};
+	}
+}
+
+#define AAZ_ISR_COMPOSE(vect, ...)                                              \
+	ISR(vect, __attribute__((flatten))) {                                      \
+		static_assert(!aaz::isr::chain<__VA_ARGS__>::empty,                    \
+		              "every fragment is dropped, leave this vector out.");    \
+		aaz::isr::chain<__VA_ARGS__>::run();                                   \
+	}
+
+#define AAZ_ISR_COMPOSE_FLAGS(vect, ...)                                        \
+	ISR(vect, ISR_NAKED) {                                                     \
+		aaz::isr::chain<__VA_ARGS__>::run_naked();                             \
+		asm volatile("reti");                                                  \
+	}
@@ -0,0 +1,308 @@
+
+#pragma once
+
+extern "C" {
+	#include <stdint.h>
+}
+
+#if defined(__AVR__)
+extern "C" {
+	#include <avr/pgmspace.h>
+}
+#	define AAZ_LADDER_ROM PROGMEM
+#else
+#	define AAZ_LADDER_ROM
+#endif
+
+
+/////////////Resistor Ladder Key Decoder
+
+/* keys sharing one ADC pin: a pull-up RUp from Vcc to the pin, and each key connects the pin
+*  to GND through its own resistor, so the reading is ratiometric (ADC reference = Vcc) and
+*  two keys pressed together put their resistors in parallel, which gives a reading of its own.
+*
+*      code = 2^Bits * Rk / (Rk + RUp)        (Rk of pressed keys in parallel, no key = full scale)
+*
+*  everything below is worked out at compile time from the resistor values:
+*    - the expected code of no key, each key, and each pair of keys.
+*    - levels: no key and single keys always, a pair only if its code is at least MinGap
+*      away from every other combination (otherwise the ladder can't tell it apart).
+*      single keys closer than MinGap to each other or to no key are a compile error.
+*    - thresholds at the midpoint between adjacent levels, and a guard band of MinGap / 4
+*      around each threshold for readings worth taking again.
+*    - a sweep of all ADC codes proving that the lookup picks the nearest level.
+*  at run time, a reading is looked up with a fixed number of steps (binary search over the
+*  thresholds in flash), whatever the number of keys. decode() of a few levels compares against immediates instead.
+*  decode_as<Map>() maps the pressed keys at compile time, e.g. to key codes, see there.
+*
+*  combinations of three keys or more are not decoded, they read as some nearby level.
+*
+* NORMAL USEAGE:
+*
+* //8-bit readings, 24 codes apart at least, 10k pull-up, keys 15k, 5.6k, 1.3k.
+* typedef aaz::ladder::decoder<8, 24, 10000, 15000, 5600, 1300> keys;
+*
+* uint8_t r = adc::read8_quiet();
+* uint8_t level = keys::find(r);
+* uint8_t pressed = keys::mask_at(level);    //bit k set for key k (the k-th resistor).
+*/
+
+namespace aaz {
+	namespace ladder {
+		namespace detail {
+			constexpr double conductance(uint8_t) {
+				return 0.0;
+			}
+
+			template<typename... Ts>
+			constexpr double conductance(uint8_t mask, uint32_t r, Ts... rest) {
+				return ((mask & 0x01) ? 1.0 / r : 0.0) + conductance(mask >> 1, rest...);
+			}
+
+			constexpr uint16_t min16(uint16_t a, uint16_t b) {
+				return a < b ? a : b;
+			}
+
+			constexpr uint16_t dist(uint16_t a, uint16_t b) {
+				return a > b ? a - b : b - a;
+			}
+
+			template<uint8_t... I>
+			struct indices {};
+
+			template<uint8_t N, uint8_t... I>
+			struct make_indices : make_indices<N - 1, N - 1, I...> {};
+
+			template<uint8_t... I>
+			struct make_indices<0, I...> {
+				typedef indices<I...> type;
+			};
+
+			/* combinations ('candidates') and their expected codes,
+			*  candidate 0 is no key, 1 - N single keys, then pairs (0,1), (0,2) ... (N-2,N-1).
+			*/
+			template<uint8_t Bits, uint32_t RUp, uint32_t... R>
+			struct ladder {
+				static constexpr uint8_t keys = sizeof...(R);
+				static constexpr uint8_t candidates = 1 + keys + keys * (keys - 1) / 2;
+				static constexpr uint16_t full_scale = (1u << Bits) - 1;
+
+				static constexpr uint16_t adc_code(double g) {
+					return g == 0.0 ? full_scale : static_cast<uint16_t>((full_scale + 1) / (1.0 + RUp * g));
+				}
+
+				static constexpr uint8_t pair_mask(uint8_t p, uint8_t i = 0) {
+					return (p < keys - 1 - i) ? static_cast<uint8_t>((1u << i) | (1u << (i + 1 + p)))
+					                          : pair_mask(p - (keys - 1 - i), i + 1);
+				}
+
+				static constexpr uint8_t mask_of(uint8_t c) {
+					return c == 0 ? 0 : c <= keys ? static_cast<uint8_t>(1u << (c - 1)) : pair_mask(c - keys - 1);
+				}
+
+				static constexpr uint16_t code_of(uint8_t c) {
+					return adc_code(conductance(mask_of(c), R...));
+				}
+			};
+
+			//expected code of every candidate, computed once.
+			template<typename Ladder, typename Idx = typename make_indices<Ladder::candidates>::type>
+			struct candidate_codes;
+
+			template<typename Ladder, uint8_t... I>
+			struct candidate_codes<Ladder, indices<I...>> {
+				static constexpr uint16_t code[sizeof...(I)] = {Ladder::code_of(I)...};
+			};
+
+			template<typename Ladder, uint8_t... I>
+			constexpr uint16_t candidate_codes<Ladder, indices<I...>>::code[sizeof...(I)];
+
+			//distance from candidate c to the nearest other one in [k, end).
+			constexpr uint16_t gap(const uint16_t *code, uint8_t c, uint8_t end, uint8_t k = 0) {
+				return k == end ? 0xffff : min16(k == c ? 0xffff : dist(code[c], code[k]), gap(code, c, end, k + 1));
+			}
+
+			//no key and single keys (candidates [0, n)), each min_gap away from the others.
+			constexpr bool singles_apart(const uint16_t *code, uint8_t n, uint8_t min_gap, uint8_t c = 0) {
+				return c == n || (gap(code, c, n) >= min_gap && singles_apart(code, n, min_gap, c + 1));
+			}
+
+			//no key and single keys always, a pair only if min_gap away from every other candidate.
+			constexpr bool included(const uint16_t *code, uint8_t n, uint8_t total, uint8_t min_gap, uint8_t c) {
+				return c < n || gap(code, c, total) >= min_gap;
+			}
+
+			constexpr uint8_t count(const uint16_t *code, uint8_t n, uint8_t total, uint8_t min_gap, uint8_t c = 0) {
+				return c == total ? 0 : (included(code, n, total, min_gap, c) ? 1 : 0) + count(code, n, total, min_gap, c + 1);
+			}
+
+			//position of an included candidate in ascending code order, included ones are min_gap apart, thus no tie.
+			constexpr uint8_t rank(const uint16_t *code, uint8_t n, uint8_t total, uint8_t min_gap, uint8_t c, uint8_t k = 0) {
+				return k == total ? 0
+				     : ((code[k] < code[c] && included(code, n, total, min_gap, k)) ? 1 : 0) + rank(code, n, total, min_gap, c, k + 1);
+			}
+
+			constexpr uint8_t at_level(const uint16_t *code, uint8_t n, uint8_t total, uint8_t min_gap, uint8_t l, uint8_t c = 0) {
+				return (included(code, n, total, min_gap, c) && rank(code, n, total, min_gap, c) == l)
+				       ? c : at_level(code, n, total, min_gap, l, c + 1);
+			}
+
+			//level of reading r, counting thresholds not above it, the same as find() does at run time.
+			template<typename Code>
+			constexpr uint8_t level_of(const Code *th, uint8_t levels, uint16_t r, uint8_t l = 0) {
+				return (l == levels - 1 || r < th[l]) ? l : level_of(th, levels, r, l + 1);
+			}
+
+			//level with expected code nearest to r, the upper one on a tie (as the rounded up midpoint).
+			constexpr uint8_t nearest(const uint16_t *code, uint8_t levels, uint16_t r, uint8_t l = 1, uint8_t best = 0) {
+				return l == levels ? best : nearest(code, levels, r, l + 1, dist(r, code[l]) <= dist(r, code[best]) ? l : best);
+			}
+
+			//every code in [lo, hi] decodes to its nearest level, split in halves to keep recursion shallow.
+			template<typename Code>
+			constexpr bool sweep(const Code *th, const uint16_t *code, uint8_t levels, uint16_t lo, uint16_t hi) {
+				return lo == hi ? level_of(th, levels, lo) == nearest(code, levels, lo)
+				     : sweep(th, code, levels, lo, lo + (hi - lo) / 2) && sweep(th, code, levels, lo + (hi - lo) / 2 + 1, hi);
+			}
+
+			template<bool Byte>
+			struct code_type {
+				typedef uint8_t type;
+			};
+
+			template<>
+			struct code_type<false> {
+				typedef uint16_t type;
+			};
+
+			//per level tables, level 0 has the lowest code, the last one is no key.
+			template<typename Ladder, uint8_t MinGap, typename Code, typename Idx>
+			struct tables;
+
+			template<typename Ladder, uint8_t MinGap, typename Code, uint8_t... I>
+			struct tables<Ladder, MinGap, Code, indices<I...>> {
+				typedef candidate_codes<Ladder> cand;
+				static constexpr uint8_t levels = sizeof...(I);
+				static constexpr uint8_t cand_of[sizeof...(I)] = {at_level(cand::code, Ladder::keys + 1, Ladder::candidates, MinGap, I)...};
+				static constexpr uint16_t code[sizeof...(I)] = {cand::code[cand_of[I]]...};
+				static constexpr uint8_t mask[sizeof...(I)] = {Ladder::mask_of(cand_of[I])...};
+				//lowest reading of level l + 1, midpoint rounded up. the last entry is a placeholder.
+				static constexpr Code th[sizeof...(I)] = {static_cast<Code>((code[I] + code[I + 1 < levels ? I + 1 : I] + 1) / 2)...};
+			};
+
+			template<typename Ladder, uint8_t MinGap, typename Code, uint8_t... I>
+			constexpr uint8_t tables<Ladder, MinGap, Code, indices<I...>>::cand_of[sizeof...(I)];
+
+			template<typename Ladder, uint8_t MinGap, typename Code, uint8_t... I>
+			constexpr uint16_t tables<Ladder, MinGap, Code, indices<I...>>::code[sizeof...(I)];
+
+			template<typename Ladder, uint8_t MinGap, typename Code, uint8_t... I>
+			constexpr uint8_t tables<Ladder, MinGap, Code, indices<I...>>::mask[sizeof...(I)] AAZ_LADDER_ROM;
+
+			template<typename Ladder, uint8_t MinGap, typename Code, uint8_t... I>
+			constexpr Code tables<Ladder, MinGap, Code, indices<I...>>::th[sizeof...(I)] AAZ_LADDER_ROM;
+
+			constexpr uint8_t same(uint8_t mask) {
+				return mask;
+			}
+
+			inline uint8_t rom_read(const uint8_t *p) {
+#if defined(__AVR__)
+				return pgm_read_byte(p);
+#else
+				return *p;
+#endif
+			}
+
+			inline uint16_t rom_read(const uint16_t *p) {
+#if defined(__AVR__)
+				return pgm_read_word(p);
+#else
+				return *p;
+#endif
+			}
+		}
+
+		template<uint8_t Bits, uint8_t MinGap, uint32_t RUp, uint32_t... R>
+		struct decoder {
+			typedef detail::ladder<Bits, RUp, R...> ladder;
+			typedef detail::candidate_codes<ladder> cand;
+			typedef typename detail::code_type<(Bits <= 8)>::type code_t;
+
+			static_assert(Bits >= 6 && Bits <= 10, "ADC resolution is 10 bits at most.");
+			static_assert(ladder::keys >= 1 && ladder::keys <= 8, "1 to 8 keys, one bit each in the key mask.");
+			static_assert(MinGap >= 4, "guard band is MinGap / 4, at least one code.");
+			static_assert(detail::singles_apart(cand::code, ladder::keys + 1, MinGap),
+			              "single keys (or no key) are closer than MinGap, choose other resistors.");
+
+			static constexpr uint8_t levels = detail::count(cand::code, ladder::keys + 1, ladder::candidates, MinGap);
+			static constexpr uint8_t guard = MinGap / 4;
+
+			typedef detail::tables<ladder, MinGap, code_t, typename detail::make_indices<levels>::type> table;
+
+			static_assert(detail::sweep(table::th, table::code, levels, 0, ladder::full_scale),
+			              "a reading decodes to a level other than the nearest.");
+
+			//binary search step count is fixed by the number of levels.
+			static constexpr uint8_t top_step(uint8_t s = 1) {
+				return (s * 2 > levels - 1) ? s : top_step(s * 2);
+			}
+
+			//level of a reading, levels are in ascending code order, the last one is no key.
+			static uint8_t find(code_t r) {
+				uint8_t l = 0;
+				for(uint8_t s = top_step(); s; s >>= 1) {
+					if(l + s <= levels - 1 && r >= detail::rom_read(&table::th[l + s - 1]))
+						l += s;
+				}
+				return l;
+			}
+
+			static inline uint8_t mask_at(uint8_t level) {
+				return detail::rom_read(&table::mask[level]);
+			}
+
+			//the reading is within the guard band of the thresholds around its level.
+			static bool near_threshold(code_t r, uint8_t level) {
+				if(level > 0 && r - detail::rom_read(&table::th[level - 1]) < guard)
+					return true;
+				if(level < levels - 1 && detail::rom_read(&table::th[level]) - r <= guard)
+					return true;
+				return false;
+			}
+
+			//pressed keys of a reading, bit k for the k-th resistor.
+			static inline uint8_t decode(code_t r) {
+				return decode_as<detail::same>(r);
+			}
+
+			/* Map(pressed keys) of a reading, Map is a constexpr function, e.g. to the key code of an application.
+			*  a few levels are compared one by one against immediates, with Map applied at compile time:
+			*  smaller than the search, and no table in flash.
+			*/
+			template<uint8_t (*Map)(uint8_t)>
+			static inline uint8_t decode_as(code_t r) {
+				return levels <= UNROLLED_LEVELS ? unrolled<Map>(r, at<0>()) : Map(mask_at(find(r)));
+			}
+
+		private:
+			static constexpr uint8_t UNROLLED_LEVELS = 4;
+
+			template<uint8_t L>
+			struct at {};
+
+			template<uint8_t (*Map)(uint8_t)>
+			static inline uint8_t unrolled(code_t, at<levels - 1>) {
+				constexpr uint8_t v = Map(table::mask[levels - 1]);
+				return v;
+			}
+
+			template<uint8_t (*Map)(uint8_t), uint8_t L>
+			static inline uint8_t unrolled(code_t r, at<L>) {
+				constexpr code_t th = table::th[L];    //constants even at -O0, the tables are in flash.
+				constexpr uint8_t v = Map(table::mask[L]);
+				return r < th ? v : unrolled<Map>(r, at<L + 1>());
+			}
+		};
+	}
+}
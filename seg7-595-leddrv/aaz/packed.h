@@ -0,0 +1,73 @@
+
+#pragma once
+
+#include "io_x.h"
+
+
+/////////////Packed State
+
+/* small state squeezed into fewer RAM bytes, the tiny parts share 64 bytes between globals and stack.
+*
+*  nibbles, two 4-bit fields in a byte: a BCD number as the DS1302 stores it, or a small code and its former value.
+*  ram_flag, one bit of a byte in RAM, same interface as aaz::isr::io_flag.
+*
+*  flags touched by an ISR, or wanted at the cost of a single instruction, go to spare I/O bits (io_flag) first,
+*  ram_flag is for the rest, and only for flags written by main loop alone, its update is not atomic.
+*
+* NORMAL USEAGE:
+*
+* aaz::packed::nibbles minute = {0x59};     //BCD 59
+* minute.set_lo(minute.lo() + 1);
+*
+* uint8_t flags;
+* typedef aaz::packed::ram_flag<flags, 0> shown;
+* shown::set();
+* if(shown::test()) ...
+*/
+
+namespace aaz {
+	namespace packed {
+		struct nibbles {
+			uint8_t raw;
+
+			inline uint8_t hi() const {
+				return high_half(raw);
+			}
+
+			inline uint8_t lo() const {
+				return low_half(raw);
+			}
+
+			//v should fit in 4 bits.
+			inline void set_hi(uint8_t v) {
+				raw = static_cast<uint8_t>((raw & 0x0f) | (v << 4));
+			}
+
+			inline void set_lo(uint8_t v) {
+				raw = static_cast<uint8_t>((raw & 0xf0) | v);
+			}
+
+			//low half moves to high half, v takes the low half (a value and the one before it).
+			inline void shift_in(uint8_t v) {
+				raw = static_cast<uint8_t>((raw << 4) | v);
+			}
+		};
+
+		template<uint8_t &Word, uint8_t Bit>
+		struct ram_flag {
+			static_assert(Bit < 8, "bit number out of range.");
+
+			static inline bool test() {
+				return static_cast<bool>(Word & _BV(Bit));
+			}
+
+			static inline void set() {
+				Word |= _BV(Bit);
+			}
+
+			static inline void clear() {
+				Word &= ~_BV(Bit);
+			}
+		};
+	}
+}
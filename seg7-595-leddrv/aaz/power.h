@@ -5,6 +5,7 @@
 
 extern "C" {
 	#include <avr/sleep.h>
+	#include <avr/interrupt.h>
 }
 
 
@@ -21,9 +22,11 @@ namespace aaz {
 		CLKPR = static_cast<uint8_t>(ckdv);
 	}
 
+	//values are the SM1:SM0 bits of MCUCR, so they are written as they are.
 	enum class sleep_mode_enum : uint8_t {
 		idle = 0x00,
-		adc_noise_reduction, power_down,
+		adc_noise_reduction = _BV(SM0),
+		power_down = _BV(SM1),
 	};
 
 	inline void set_sleep_mode_as(sleep_mode_enum mode) {
@@ -36,6 +39,24 @@ namespace aaz {
 		MCUCR &= ~_BV(SE);
 	}
 
+	//call with interrupt disabled, after checking there is nothing left to do.
+	//the instruction after 'sei' always executes before any pending interrupt,
+	//so an interrupt arriving after the check still wakes the cpu instead of being slept through.
+	inline void sei_and_sleep() {
+		MCUCR |= _BV(SE);
+		sei();
+		sleep_cpu();
+		MCUCR &= ~_BV(SE);
+	}
+
+	//the same in a given sleep mode, which is set with SE in one write.
+	inline void sei_and_sleep_as(sleep_mode_enum mode) {
+		MCUCR = ((MCUCR & ~(_BV(SM0) | _BV(SM1))) | static_cast<uint8_t>(mode) | _BV(SE));
+		sei();
+		sleep_cpu();
+		MCUCR &= ~_BV(SE);
+	}
+
 	inline void shutdown_adc() {
 		PRR |= _BV(PRADC);
 	}
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include "io_x.h"
+#include "timer0.h"
+
+
+/////////////Section Profiler
+
+namespace aaz {
+	namespace prof {
+		/* run time of a code section in timer0 ticks, timer0 must be counting freely (any mode, TOP = 0xff).
+		*  1 tick = timer0 prescaler cycles, e.g. 8 cycles at div_8,
+		*  the longest section measured correctly is 255 ticks (2040 cycles at div_8), longer ones wrap.
+		*/
+		struct stat {
+			uint8_t min;
+			uint8_t max;
+			uint16_t count;     //saturates at 0xffff, total and min / max stop there as well.
+			uint32_t total;
+
+			inline void add(uint8_t ticks) {
+				if(count == 0xffff)
+					return;
+				if(!count || ticks < min)
+					min = ticks;
+				if(ticks > max)
+					max = ticks;
+				total += ticks;
+				++count;
+			}
+		};
+
+		/* scope guard, timestamps entry and exit with TCNT0 and adds the difference to a stat.
+		*  all inline, with a global stat the cost is two TCNT0 reads and the update (around 30 cycles),
+		*  which is not included in the result.
+		*
+		* aaz::prof::stat prof_table[2];
+		*
+		* void display_step() {
+		*     aaz::prof::scope ps(prof_table[0]);
+		*     ...
+		* }
+		*
+		* prof_table is read from the simulator memory view, or sent out by the application.
+		*/
+		class scope {
+		public:
+			inline explicit scope(stat &s): s(s), start(TCNT0) {}
+
+			inline ~scope() {
+				s.add(static_cast<uint8_t>(TCNT0 - start));
+			}
+
+		private:
+			stat &s;
+			uint8_t start;
+		};
+
+		constexpr uint32_t cycles_of(uint32_t ticks, t0::timer0_clkdiv ckdv) {
+			return ticks * t0::calc_prescale(ckdv);
+		}
+	}
+}
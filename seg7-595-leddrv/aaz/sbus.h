@@ -0,0 +1,223 @@
+
+#pragma once
+
+#include "io_x.h"
+#include "timing.h"
+
+
+/////////////Bit-bang Serial Bus
+
+/* synchronous serial bus on plain port pins, everything is fixed at compile time,
+*  so each device driver is the same loop a hand written one would be, no pin or mode is kept in RAM.
+*
+*  devices sharing the clock and data lines share one bus type, and thus one copy of write() / read().
+*
+*  datasheet minimum times (ns) come as a Timing type and are padded for F_CPU at compile time (aaz/timing.h),
+*  so a driver keeps them at any clock, with no padding at all where the code is slow enough by itself.
+*
+* NORMAL USEAGE:
+*
+* struct ds1302 : aaz::sbus::untimed {
+*     static constexpr uint16_t clk_high = 1000;
+*     static constexpr uint16_t clk_low = 1000;
+* };
+* typedef aaz::sbus::timing_max<ds1302, hc595> timing;    //the strictest of the devices on the bus
+*
+* typedef aaz::sbus::bus<PORTB2, PORTB0, PINB0, aaz::sbus::bit_order::lsb_first,
+*                        aaz::sbus::clock_idle::low, aaz::sbus::sample_at::idle, timing> bus;
+* typedef aaz::sbus::strobe<PORTB4, true, timing> latch;    //74HC595 RCLK
+* typedef aaz::sbus::select<PORTB4, true, timing> chip;     //DS1302 CE
+*
+* bus::write(a);
+* latch::pulse();
+*
+* {
+*     chip c;                 //CE high in this scope
+*     bus::write(cmd);
+*     bus::release();         //device drives data line
+*     uint8_t d = bus::read();
+*     bus::drive();
+* }
+*/
+
+namespace aaz {
+	namespace sbus {
+		enum class bit_order : uint8_t {
+			lsb_first,
+			msb_first,
+		};
+
+		//clock level between pulses, leading edge goes away from it.
+		enum class clock_idle : uint8_t {
+			low,
+			high,
+		};
+
+		//when read() samples the data line in each bit.
+		enum class sample_at : uint8_t {
+			idle,      //before the leading edge, device changes data at the trailing edge (DS1302, 74HC165).
+			active,    //between leading and trailing edge, device changes data at the leading edge.
+		};
+
+		//minimum times in ns, 0 for none, a device type derives from this and sets what its datasheet gives.
+		struct untimed {
+			static constexpr uint16_t clk_high = 0;        //clock leading to trailing edge.
+			static constexpr uint16_t clk_low = 0;         //clock trailing to next leading edge.
+			static constexpr uint16_t setup = 0;           //data out to clock leading edge.
+			static constexpr uint16_t hold = 0;            //data out kept after clock leading edge.
+			static constexpr uint16_t valid = 0;           //clock edge to data in valid, trailing (sample_at::idle) or leading.
+			static constexpr uint16_t strobe = 0;          //strobe pulse width.
+			static constexpr uint16_t strobe_setup = 0;    //last clock edge to strobe.
+			static constexpr uint16_t select_setup = 0;    //chip select to first clock leading edge.
+			static constexpr uint16_t select_hold = 0;     //last clock edge to chip select release.
+			static constexpr uint16_t select_idle = 0;     //chip select inactive before it's taken again, strobes on its pin too.
+		};
+
+		//the strictest times of all devices on a bus.
+		template<typename... Devices>
+		struct timing_max : untimed {};
+
+		template<typename Device, typename... Rest>
+		struct timing_max<Device, Rest...> {
+			typedef timing_max<Rest...> rest;
+
+			static constexpr uint16_t clk_high = timing::max_of(Device::clk_high, rest::clk_high);
+			static constexpr uint16_t clk_low = timing::max_of(Device::clk_low, rest::clk_low);
+			static constexpr uint16_t setup = timing::max_of(Device::setup, rest::setup);
+			static constexpr uint16_t hold = timing::max_of(Device::hold, rest::hold);
+			static constexpr uint16_t valid = timing::max_of(Device::valid, rest::valid);
+			static constexpr uint16_t strobe = timing::max_of(Device::strobe, rest::strobe);
+			static constexpr uint16_t strobe_setup = timing::max_of(Device::strobe_setup, rest::strobe_setup);
+			static constexpr uint16_t select_setup = timing::max_of(Device::select_setup, rest::select_setup);
+			static constexpr uint16_t select_hold = timing::max_of(Device::select_hold, rest::select_hold);
+			static constexpr uint16_t select_idle = timing::max_of(Device::select_idle, rest::select_idle);
+		};
+
+		//Dout and Din are usually the same port bit (PORTBn / PINBn) for a bidirectional data line.
+		template<uint8_t Clk, uint8_t Dout, uint8_t Din, bit_order Order,
+		         clock_idle Idle = clock_idle::low, sample_at Sample = sample_at::idle, typename Timing = untimed>
+		struct bus {
+			static inline void leading_edge() {
+				if(Idle == clock_idle::low)
+					setpin(Clk);
+				else
+					clrpin(Clk);
+			}
+
+			static inline void trailing_edge() {
+				if(Idle == clock_idle::low)
+					clrpin(Clk);
+				else
+					setpin(Clk);
+			}
+
+			//data is held until the trailing edge at least, the next leading edge is one sbi / cbi away at least.
+			static inline void pulse() {
+				leading_edge();
+				timing::hold<timing::max_of(Timing::clk_high, Timing::hold), timing::IO_BIT_CYCLES>();
+				trailing_edge();
+				timing::hold<Timing::clk_low, timing::IO_BIT_CYCLES>();
+			}
+
+			//data is set while clock idles, device takes it at the leading edge.
+			//write() and read() are never inlined: every driver on the bus calls them, one copy each is far smaller.
+			static __attribute__((noinline)) void write(uint8_t a) {
+				for(uint8_t i = 8; i; --i) {
+					if(Order == bit_order::lsb_first) {
+						if(a & 0x01)
+							setpin(Dout);
+						else
+							clrpin(Dout);
+						a >>= 1;
+					}
+					else {
+						if(a & 0x80)
+							setpin(Dout);
+						else
+							clrpin(Dout);
+						a <<= 1;
+					}
+					timing::hold<Timing::setup, timing::IO_BIT_CYCLES>();
+					pulse();
+				}
+			}
+
+			//data line should be released first.
+			static __attribute__((noinline)) uint8_t read() {
+				uint8_t d = 0;
+				for(uint8_t i = 8; i; --i) {
+					if(Sample == sample_at::active)
+						leading_edge();
+					timing::hold<Timing::valid, 1>();    //the pin is read in the first cycle of sbic / sbis.
+
+					if(Order == bit_order::lsb_first) {
+						d >>= 1;
+						if(test_pin(Din))
+							d |= 0x80;
+					}
+					else {
+						d <<= 1;
+						if(test_pin(Din))
+							d |= 0x01;
+					}
+
+					if(Sample == sample_at::active)
+						trailing_edge();
+					else
+						pulse();
+				}
+				return d;
+			}
+
+			//data line turns input, for the device to drive it.
+			static inline void release() {
+				clr_pins_out(Dout);
+			}
+
+			static inline void drive() {
+				set_pins_out(Dout);
+			}
+		};
+
+		//a latch or load pulse on its own pin, ActiveHigh = false for active low inputs (74HC165 SH/LD).
+		template<uint8_t Pin, bool ActiveHigh = true, typename Timing = untimed>
+		struct strobe {
+			static inline void pulse() {
+				timing::hold<Timing::strobe_setup, timing::IO_BIT_CYCLES>();
+				if(ActiveHigh)
+					setpin(Pin);
+				else
+					clrpin(Pin);
+				timing::hold<Timing::strobe, timing::IO_BIT_CYCLES>();
+				if(ActiveHigh)
+					clrpin(Pin);
+				else
+					setpin(Pin);
+			}
+		};
+
+		//chip enable scope guard, the device is selected for the lifetime of the object.
+		//the pin may have been released (or strobed) right before, so the idle time is padded in full.
+		//a data write and a clock edge (two sbi / cbi) come before the first clock leading edge.
+		template<uint8_t Pin, bool ActiveHigh = true, typename Timing = untimed>
+		class select {
+		public:
+			inline select() {
+				timing::hold<Timing::select_idle, timing::IO_BIT_CYCLES>();
+				if(ActiveHigh)
+					setpin(Pin);
+				else
+					clrpin(Pin);
+				timing::hold<Timing::select_setup, 2 * timing::IO_BIT_CYCLES>();
+			}
+
+			inline ~select() {
+				timing::hold<Timing::select_hold, timing::IO_BIT_CYCLES>();
+				if(ActiveHigh)
+					clrpin(Pin);
+				else
+					setpin(Pin);
+			}
+		};
+	}
+}
@@ -0,0 +1,146 @@
+
+#pragma once
+
+#include "io_x.h"
+#include "power.h"
+
+extern "C" {
+	#include <avr/interrupt.h>
+}
+
+
+/////////////Soft Timer
+
+namespace aaz {
+	namespace stimer {
+		typedef void (*callback)();
+		typedef uint16_t tick_t;
+
+		/* a small static table of soft timers sharing one tick source.
+		*
+		* callbacks are given as template arguments, so they are called directly (and mostly inlined),
+		* no function pointer is stored in RAM, each timer costs 4 bytes.
+		* timer id is the position of its callback in the argument list.
+		*
+		* NORMAL USEAGE:
+		*
+		* void refresh();
+		* void sync();
+		* aaz::stimer::wheel<refresh, sync> timers;
+		*
+		* ISR(iv_timer0_overflow) {
+		*     timers.tick();
+		* }
+		*
+		* timers.start(0, 1, 1);        //periodic, every tick
+		* timers.start(1, 100);         //one-shot, 100 ticks later
+		* while(true)
+		*     timers.dispatch();        //sleep in idle mode until something is due
+		*
+		* start() and stop() are for main loop (and callbacks) only, not for ISR.
+		*/
+		template<callback... Cbs>
+		class wheel {
+		public:
+			static constexpr uint8_t size = sizeof...(Cbs);
+
+			//call from the interrupt which provides time base.
+			inline void tick() {
+				++pending;
+			}
+
+			//first expiry after 'ticks' (>= 1) ticks, then every 'period' ticks, 0 for one-shot.
+			inline void start(uint8_t id, tick_t ticks, tick_t period = 0) {
+				slots[id].remain = ticks;
+				slots[id].period = period;
+			}
+
+			inline void stop(uint8_t id) {
+				slots[id].remain = 0;
+			}
+
+			inline bool running(uint8_t id) const {
+				return slots[id].remain != 0;
+			}
+
+			inline tick_t period(uint8_t id) const {
+				return slots[id].period;
+			}
+
+			/* fire callbacks of expired timers in id order,
+			*  or sleep in idle mode when no tick is pending.
+			*  any interrupt wakes the cpu, so ISR side flags can be checked right after this returns.
+			*  ticks missed by a long callback are accumulated and passed in one go,
+			*  periodic timers are reloaded without carrying the overshoot.
+			*/
+			void dispatch() {
+				cli();
+				uint8_t n = pending;
+				if(!n) {
+					sei_and_sleep_as(sleep_mode_enum::idle);
+					return;
+				}
+				pending = 0;
+				sei();
+				advance(n);
+			}
+
+			/* same as dispatch(), but the pending tick is a single flag bit (aaz::isr::io_flag)
+			*  set by a naked ISR (AAZ_ISR_COMPOSE_FLAGS) instead of tick().
+			*  ticks missed while a callback runs long are lost, not accumulated.
+			*  returns true if a tick was passed, false if it has slept.
+			*/
+			template<typename Flag>
+			bool dispatch_flag() {
+				cli();
+				if(!Flag::test()) {
+					sei_and_sleep_as(sleep_mode_enum::idle);
+					return false;
+				}
+				Flag::clear();
+				sei();
+				advance(1);
+				return true;
+			}
+
+			//pass n ticks, fire callbacks of expired timers.
+			inline void advance(uint8_t n) {
+				expire<0, Cbs...>(n);
+			}
+
+		private:
+			struct slot {
+				tick_t remain;    //0 == stopped
+				tick_t period;    //0 == one-shot
+			};
+
+			template<uint8_t I>
+			inline void expire(uint8_t) {}
+
+			//pass n ticks to one timer, true if it expires.
+			//out of line, the unrolled expire() is then a call and a branch per timer.
+			static __attribute__((noinline)) bool due(slot &s, uint8_t n) {
+				if(!s.remain)
+					return false;
+				if(s.remain > n) {
+					s.remain -= n;
+					return false;
+				}
+				//reload before the call, so the callback may restart or stop its own timer.
+				s.remain = s.period;
+				return true;
+			}
+
+			template<uint8_t I, callback Cb, callback... Rest>
+			inline void expire(uint8_t n) {
+				if(due(slots[I], n))
+					Cb();
+				expire<I + 1, Rest...>(n);
+			}
+
+			//instances are meant to be globals, thus zero initialized, all timers stopped.
+			slot slots[size];
+			volatile uint8_t pending;
+		};
+	}
+}
@@ -0,0 +1,41 @@
+
+#pragma once
+
+extern "C" {
+	#include <avr/io.h>
+	#include <stdint.h>
+	
+	//first byte after static data (.data, .bss, .noinit), provided by the linker script.
+	extern uint8_t __heap_start;
+}
+
+
+/////////////Stack Watermark
+
+/* free RAM between static data and stack is painted with a known byte once at startup,
+*  stack never shrinks the painted area back, so the bytes still painted later on
+*  are the lowest free space ever seen (low-water mark).
+*  no heap is expected, malloc would overwrite the paint.
+*/
+
+namespace aaz {
+	namespace stack {
+		constexpr uint8_t PAINT = 0xc5;
+		
+		//call early in main, with interrupts still disabled.
+		//paints below the current stack pointer only, the caller's frame stays untouched.
+		inline void paint() {
+			uint8_t *sp = reinterpret_cast<uint8_t *>(SP);
+			for(uint8_t *p = &__heap_start; p < sp; ++p)
+				*p = PAINT;
+		}
+		
+		//bytes never reached by the stack since paint(), RAM is below 256 bytes on tiny devices.
+		inline uint8_t unused() {
+			const uint8_t *p = &__heap_start;
+			while(*p == PAINT)
+				++p;
+			return static_cast<uint8_t>(p - &__heap_start);
+		}
+	}
+}
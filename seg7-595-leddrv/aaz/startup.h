@@ -0,0 +1,13 @@
+
+#pragma once
+
+/* main declaration for use with aaz minimal startup (src/startup.S),
+*  also fine with the default crt.
+*
+*  main is jumped to and must never return, end it with an endless loop,
+*  then no call-saved register is pushed on entry and no epilogue / exit path is emitted.
+*  (g++ rejects 'noreturn' on main because of its implicit 'return 0', OS_main does the job.)
+*
+*  AAZ_NORETURN_MAIN int main();
+*/
+#define AAZ_NORETURN_MAIN __attribute__((OS_main))
@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include "io_x.h"
+
+extern "C" {
+	#include <avr/interrupt.h>
+}
+
+
+/////////////Software UART (transmit only)
+
+namespace aaz {
+	namespace suart {
+		/* bit-banged 8N1 transmitter paced by timer0 compare match B, LSB first, line idles high.
+		*
+		* timer0 keeps counting freely for its other users (overflow, compare A),
+		* each bit moves OCR0B forward by BitTicks, so bits are evenly spaced whatever timer0 overflow is used for.
+		*     baud = F_CPU / timer0 prescaler / BitTicks,  e.g. 1.2MHz / 8 / 31 = 4839 (4800 +0.8%).
+		*
+		* bytes are queued to a ring buffer in RAM by main loop and shifted out by the ISR,
+		* a block which doesn't fit is dropped as a whole, put() never waits.
+		* ISR costs around 40 cycles per bit, only while there is something to send.
+		*
+		* NORMAL USEAGE:
+		*
+		* aaz::suart::tx<PORTB1, 31, 16> uart;
+		*
+		* ISR(iv_timer0_ocb) {
+		*     uart.on_compare();
+		* }
+		*
+		* set_pins_out(PORTB1);         //idle level before the pin turns output
+		* set_ddr(PORTB1);
+		* t0::start_at(t0::timer0_clkdiv::div_8);
+		* sei();
+		* uart.put(record, sizeof(record));
+		*
+		* sleep modes other than idle halt timer0 and stretch the bit on the line, check busy() before entering them.
+		* compare B interrupt enable bit is owned by this class, don't overwrite TIMSK0 as a whole while busy().
+		*/
+		template<uint8_t Pin, uint8_t BitTicks, uint8_t BufSize>
+		class tx {
+		public:
+			static_assert(BufSize && !(BufSize & (BufSize - 1)), "buffer size should be power of 2.");
+			static_assert(BitTicks >= 16, "too few timer0 ticks per bit to finish the ISR in time.");
+
+			//queue n bytes, false if there is not enough room (nothing queued).
+			bool put(const uint8_t *data, uint8_t n) {
+				uint8_t h = head;
+				if(static_cast<uint8_t>(BufSize - 1 - ((h - tail) & MASK)) < n)
+					return false;
+				while(n--) {
+					buf[h] = *data++;
+					h = (h + 1) & MASK;
+				}
+				head = h;
+				if(!busy())
+					kick();
+				return true;
+			}
+
+			//a byte is on the line or waiting in buffer.
+			inline bool busy() const {
+				return static_cast<bool>(TIMSK0 & _BV(OCIE0B));
+			}
+
+			//call from ISR(iv_timer0_ocb) only.
+			inline void on_compare() {
+				OCR0B += BitTicks;
+				if(!bits) {
+					uint8_t t = tail;
+					if(t == head) {
+						TIMSK0 &= ~_BV(OCIE0B);    //stop bit has been on the line for a whole bit.
+						return;
+					}
+					frame = (static_cast<uint16_t>(buf[t]) << 1) | 0x200;    //start bit 0, 8 data bits, stop bit 1.
+					tail = (t + 1) & MASK;
+					bits = 10;
+				}
+				if(frame & 0x01)
+					setpin(Pin);
+				else
+					clrpin(Pin);
+				frame >>= 1;
+				--bits;
+			}
+
+		private:
+			static constexpr uint8_t MASK = BufSize - 1;
+
+			//first compare match one bit later, which puts the start bit on the line.
+			//compare B is disabled here, ISR cannot race with the TIMSK0 update.
+			inline void kick() {
+				OCR0B = TCNT0 + BitTicks;
+				TIFR0 = _BV(OCF0B);
+				TIMSK0 |= _BV(OCIE0B);
+			}
+
+			//head is written by main loop only, tail by ISR only, single byte access needs no locking.
+			volatile uint8_t head;
+			volatile uint8_t tail;
+			uint8_t buf[BufSize];
+			uint16_t frame;
+			uint8_t bits;
+		};
+	}
+}
@@ -5,6 +5,7 @@
 
 extern "C" {
 	#include <assert.h>
+	#include <avr/interrupt.h>
 }
 
 #ifndef F_CPU
@@ -110,6 +111,18 @@ namespace aaz {
 			TIMSK0 = calc_timer0_intmask(timer0_ovf, compare_match_a, compare_match_b);
 		}
 		
+		//compare A enable bit alone, the other bits may be owned by a driver (OCIE0B of aaz::suart),
+		//TIMSK0 is out of sbi / cbi reach, the read-modify-write is kept from ISRs.
+		inline void set_compare_a_interrupt(bool enable) {
+			uint8_t sreg = SREG;
+			cli();
+			if(enable)
+				TIMSK0 |= _BV(OCIE0A);
+			else
+				TIMSK0 &= ~_BV(OCIE0A);
+			SREG = sreg;
+		}
+		
 		inline void set_val(uint8_t init_val) {
 			TCNT0 = init_val;
 		}
@@ -0,0 +1,68 @@
+
+#pragma once
+
+#include "io_x.h"
+
+extern "C" {
+	#include <avr/builtins.h>
+}
+
+#ifndef F_CPU
+# warning "F_CPU should be defined to use timing functions."
+#endif
+
+
+/////////////Cycle Timing
+
+/* minimum times in nanoseconds, turned into cycle padding for F_CPU at compile time,
+*  so a pulse or setup time holds at any clock without hand tuned _NOP()s.
+*
+*  the instructions around a wait already take some cycles (Given), only the rest is padded,
+*  by __builtin_avr_delay_cycles(): nothing, a nop, rjmp .+0 or a loop, whichever is shortest.
+*  interrupts can only stretch these times, minimums hold with interrupts enabled.
+*
+* NORMAL USEAGE:
+*
+* setpin(PORTB2);
+* aaz::timing::hold<1000, aaz::timing::IO_BIT_CYCLES>();    //high for 1us at least, counting the cbi below.
+* clrpin(PORTB2);
+*
+* static_assert(aaz::timing::covers(75, 2), "2 cycles are a 75ns pulse at this clock.");
+*/
+
+namespace aaz {
+	namespace timing {
+		//sbi / cbi, a pin changes 2 cycles after the one before at the earliest.
+		constexpr uint8_t IO_BIT_CYCLES = 2;
+
+		//cycles taking ns at least, rounded up.
+		constexpr uint32_t cycles_of(uint32_t ns) {
+			return static_cast<uint32_t>((static_cast<uint64_t>(F_CPU) * ns + 999999999ULL) / 1000000000ULL);
+		}
+
+		//ns taken by n cycles, rounded down.
+		constexpr uint32_t ns_of(uint32_t cycles) {
+			return static_cast<uint32_t>(static_cast<uint64_t>(cycles) * 1000000000ULL / F_CPU);
+		}
+
+		constexpr bool covers(uint32_t ns, uint32_t given) {
+			return cycles_of(ns) <= given;
+		}
+
+		constexpr uint32_t padding(uint32_t ns, uint32_t given) {
+			return covers(ns, given) ? 0 : cycles_of(ns) - given;
+		}
+
+		constexpr uint16_t max_of(uint16_t a, uint16_t b) {
+			return (a > b) ? a : b;
+		}
+
+		//Ns passed since the last pin change, when Given cycles follow before the next one.
+		template<uint32_t Ns, uint32_t Given = 0>
+		inline __attribute__((always_inline)) void hold() {
+			static_assert(padding(Ns, Given) <= 0xff, "too long for a bus wait, use _delay_us().");
+			if(padding(Ns, Given))
+				__builtin_avr_delay_cycles(padding(Ns, Given));
+		}
+	}
+}
@@ -0,0 +1,52 @@
+
+#pragma once
+
+#include "ambient.h"
+
+
+/////////////Supply Voltage
+
+/* Vcc is measured by converting the internal 1.1V bandgap with Vcc as ADC reference:
+*      reading = 1.1V * 256 / Vcc           (8-bit, left aligned)
+*  thus a lower supply gives a higher reading, 3.3V reads 85, 2.4V reads 117.
+*  the conversion itself is aaz::adc::read_vcc8(), this part has no register access and compiles on host,
+*  so a policy is tested against simulated discharge curves, see tools/vcctiers.cpp.
+*
+*  the bandgap is 1.0V - 1.2V over parts (datasheet), readings are good for tiers, not for a voltmeter.
+*
+* NORMAL USEAGE:
+*
+* //tier 0 above 3.0V, 1 below 3.0V, 2 below 2.7V, 3% hysteresis.
+* typedef aaz::vcc::tiers<5, 3000, 2700> supply;
+*
+* tier = supply::next(tier, aaz::adc::read_vcc8<2>());
+*/
+
+namespace aaz {
+	namespace vcc {
+		constexpr uint16_t BANDGAP_MV = 1100;
+
+		constexpr uint8_t reading_of(uint16_t mv) {
+			return static_cast<uint8_t>(static_cast<uint32_t>(BANDGAP_MV) * 256 / mv);
+		}
+
+		//0xffff for a reading of 0 (Vcc far above range).
+		constexpr uint16_t mv_of(uint8_t reading) {
+			return reading ? static_cast<uint16_t>(static_cast<uint32_t>(BANDGAP_MV) * 256 / reading) : 0xffff;
+		}
+
+		/* supply tiers from thresholds in mV, descending: tier k is below the k-th threshold.
+		*  a level curve on the readings, with proportional hysteresis of 2^-HystShift,
+		*  and one tier per call at most, so a single reading taken under a load spike costs one step.
+		*/
+		template<uint8_t HystShift, uint16_t... Mv>
+		struct tiers : ambient::curve<HystShift, reading_of(Mv)...> {
+			static_assert(sizeof...(Mv) >= 1, "at least one threshold.");
+
+			static constexpr uint16_t mv[sizeof...(Mv)] = {Mv...};
+		};
+
+		template<uint8_t HystShift, uint16_t... Mv>
+		constexpr uint16_t tiers<HystShift, Mv...>::mv[sizeof...(Mv)];
+	}
+}
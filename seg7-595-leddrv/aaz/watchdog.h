@@ -46,6 +46,13 @@ namespace aaz {
 			//watchdog_mute();
 		}
 		
+		//reset cause flags (PORF, EXTRF, BORF, WDRF) of the last reset, all cleared for the next one.
+		inline uint8_t take_reset_flags() {
+			uint8_t f = MCUSR;
+			MCUSR = 0x00;
+			return f;
+		}
+		
 		//'cli()' may be needed before call this
 		inline void run(wdt_mode m, wdt_prescaler p) {
 			wdt_reset();
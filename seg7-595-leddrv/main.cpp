@@ -6,7 +6,96 @@
 *    MAX CALL STACK DEPTH  32          :  additional 2-byte RAM should be reserved for interrupt routine, thus max available CALL STACK DEPTH - 1.
 */
 
-#define F_CPU (1200000UL)  //1.2Mhz
+//9.6MHz internal RC with CKDIV8 fuse, bus timing, soft timer tick, ADC clock and baud rate follow any other clock.
+#ifndef F_CPU
+#	define F_CPU (1200000UL)  //1.2Mhz
+#endif
+
+//optional features, which don't fit in 1k flash, are enabled by default on larger parts (ATtiny25/45/85).
+#if defined(__AVR_ATtiny13A__) || defined(__AVR_ATtiny13__)
+#	define CLK_LARGE_FLASH 0
+#else
+#	define CLK_LARGE_FLASH 1
+#endif
+
+//pre-rendered text messages and scrolling.
+#ifndef CLK_MESSAGES
+#	define CLK_MESSAGES CLK_LARGE_FLASH
+#endif
+
+//binary telemetry records sent out of PB1 as 4800 baud serial, see tools/telemetry.cpp.
+//a debug build feature, not a product one: PB1 is taken from light sensing.
+#ifndef CLK_TELEMETRY
+#	define CLK_TELEMETRY 0
+#endif
+
+//ambient light sensing on PB1.
+#ifndef CLK_LIGHT
+#	define CLK_LIGHT (CLK_LARGE_FLASH && !CLK_TELEMETRY)
+#endif
+
+#if CLK_LIGHT && CLK_TELEMETRY
+#	error "light sensing and telemetry share PB1, enable one of them."
+#endif
+
+//keys read from a 74HC165 on the serial bus instead of the ADC resistor ladder, KEY_IN becomes its SH/LD.
+#ifndef CLK_KEY_165
+#	define CLK_KEY_165 0
+#endif
+
+//ladder keys are converted in ADC noise reduction sleep, otherwise the cpu polls the conversion (no ADC interrupt).
+#ifndef CLK_KEY_QUIET
+#	define CLK_KEY_QUIET CLK_LARGE_FLASH
+#endif
+
+//a ladder key reading near a threshold is taken again with 4 averaged conversions.
+#ifndef CLK_KEY_OVERSAMPLE
+#	define CLK_KEY_OVERSAMPLE CLK_LARGE_FLASH
+#endif
+
+//DS1302 transactions queued and run right after a digit latch (rtcq), otherwise run at once where they are posted.
+#ifndef CLK_RTC_QUEUE
+#	define CLK_RTC_QUEUE CLK_LARGE_FLASH
+#endif
+
+//low power glance display toggled by key A, one digit at a time latched in 595 while the cpu is powered down.
+#ifndef CLK_GLANCE
+#	define CLK_GLANCE CLK_LARGE_FLASH
+#endif
+
+//supply voltage tiers on the bandgap: dimmer, slower, fewer syncs, then glance display as Vcc drops.
+//needs the bandgap ADC channel of ATtiny25/45/85.
+#ifndef CLK_VCC
+#	define CLK_VCC CLK_LARGE_FLASH
+#endif
+
+#if CLK_VCC && !CLK_GLANCE
+#	error "supply tiers end in glance display, enable CLK_GLANCE."
+#endif
+
+//segment-major multiplexing, one segment line across all digits per step instead of one digit with all its segments:
+//peak current and brightness don't depend on the digits shown, at half the frame rate, see seg7_line_cache.
+#ifndef CLK_SEG_SCAN
+#	define CLK_SEG_SCAN 0
+#endif
+
+//reset, uptime and RTC failure counters kept in EEPROM, shown by key B, see tools/diagdump.cpp.
+#ifndef CLK_DIAG
+#	define CLK_DIAG CLK_LARGE_FLASH
+#endif
+
+//soft timer tick measured against DS1302 seconds, RTC syncs then land right after each minute change.
+#ifndef CLK_CALIB
+#	define CLK_CALIB CLK_LARGE_FLASH
+#endif
+
+//keys stay scanned in the clock routine for these.
+#define CLK_CLOCK_KEYS (CLK_GLANCE || CLK_DIAG)
+
+//cycle profiling of hot sections, results in 'prof_table' (and telemetry records when enabled).
+#ifndef CLK_PROF
+#	define CLK_PROF 0
+#endif
 
 extern "C" {
 	#include <avr/interrupt.h>
@@ -17,12 +106,17 @@ extern "C" {
 	#include <util/delay.h>
 	#include <avr/interrupt.h>
 	#include <stdint.h>
+	#include <stddef.h>
 	#include <assert.h>
 }
 
 #include "aaz/aaz.h"
 #include "aaz/annex.h"
 
+#if CLK_VCC && !defined(MUX3)
+#	error "no bandgap ADC channel on this part, disable CLK_VCC."
+#endif
+
 /* 595  DS1302 SCLK RCLK/CE DS ݴš
    DS1302 CE ڼݴ䣬595 RCLKCEʱһ£
     RCLK/CE ʵָõĻ
@@ -42,52 +136,77 @@ PIN_USE  CE_1302  = PORTB4;
 //DS_IN read external level after DS is set, otherwise DS_IN is pulled low.
 PIN_USE  DS_IN    = PINB0;
 PIN_USE  KEY_IN   = PINB3;    //ADC input for key reading.
+PIN_USE  LOAD_165 = PORTB3;   //74HC165 SH/LD (active low) in CLK_KEY_165 builds.
+
+PIN_USE  SPARE    = PORTB1;
+
+//photoresistor from Vcc to LIGHT_IN, capacitor from LIGHT_IN to GND.
+//PB1 is not an ADC channel, light is measured as the capacitor charge time up to the bandgap voltage,
+//using analog comparator (AIN1 against internal bandgap).
+PIN_USE  LIGHT_IN = SPARE;
+
+//telemetry serial output, leave the photoresistor and capacitor off when used.
+PIN_USE  TELEMETRY_TX = SPARE;
+
+/* datasheet minimum times at 2.0V in ns, the bus pads the strictest of them for F_CPU (aaz/timing.h).
+*  nothing needs padding at 1.2MHz but DS1302 chip enable, at 9.6MHz a bit takes ~2us instead of ~8us.
+*/
+struct ds1302_timing : aaz::sbus::untimed {
+	static constexpr uint16_t clk_high = 1000;        //tCH
+	static constexpr uint16_t clk_low = 1000;         //tCL
+	static constexpr uint16_t setup = 200;            //tDC
+	static constexpr uint16_t hold = 280;             //tCDH
+	static constexpr uint16_t valid = 800;            //tCDD
+	static constexpr uint16_t select_setup = 4000;    //tCC
+	static constexpr uint16_t select_hold = 240;      //tCCH
+	static constexpr uint16_t select_idle = 4000;     //tCWH, RCLK pulses drop CE as well.
+};
+
+struct hc595_timing : aaz::sbus::untimed {
+	static constexpr uint16_t clk_high = 75;          //tW
+	static constexpr uint16_t clk_low = 75;
+	static constexpr uint16_t setup = 75;             //tsu DS to SCLK
+	static constexpr uint16_t strobe = 75;            //tW RCLK
+	static constexpr uint16_t strobe_setup = 100;     //tsu SCLK to RCLK
+};
+
+struct hc165_timing : aaz::sbus::untimed {
+	static constexpr uint16_t clk_high = 100;         //tW CP
+	static constexpr uint16_t clk_low = 100;
+	static constexpr uint16_t valid = 200;            //tPD CP / PL to Q7, through the 4.7k to DS.
+	static constexpr uint16_t strobe = 100;           //tW PL
+};
+
+#if CLK_KEY_165
+typedef aaz::sbus::timing_max<ds1302_timing, hc595_timing, hc165_timing> bus_timing;
+#else
+typedef aaz::sbus::timing_max<ds1302_timing, hc595_timing> bus_timing;
+#endif
+
+//SCLK and DS are shared by 595 and DS1302 (and 74HC165), all of them take LSB first at SCLK rising edge.
+typedef aaz::sbus::bus<SCLK, DS, DS_IN, aaz::sbus::bit_order::lsb_first,
+                       aaz::sbus::clock_idle::low, aaz::sbus::sample_at::idle, bus_timing> serial_bus;
 
 namespace shiftdrv {
 	//led or seg7 led driver using 595,
 	//functions can also be used in serial communication to other chip.
 	//before sending bits, configure SCLK, RCLK, DS pin as output, keep SCLK, RCLK at low level.
 	
+	typedef aaz::sbus::strobe<RCLK_595, true, bus_timing> rclk;
+	
 	//rclk positive pulse
 	inline void rclk_ppulse() {
-		aaz::setpin(RCLK_595);
-		_NOP();
-		aaz::clrpin(RCLK_595);
-		//_NOP();
+		rclk::pulse();
 	}
 
 	inline void sclk_ppulse() {
-		aaz::setpin(SCLK);
-		_NOP();
-		//_delay_us(1);
-		aaz::clrpin(SCLK);
-		//_NOP();
-	}
-	
-	//output a byte form MSB to LSB, each bit write at a positive pulse
-	void msb_shift_out(uint8_t a) {
-		for(uint8_t i = 8; i; --i) {
-			if (a & 0x80)
-				aaz::setpin(DS);
-			else
-				aaz::clrpin(DS);
-			a <<= 1;
-			sclk_ppulse();
-		}
+		serial_bus::pulse();
 	}
 	
 	//output a byte form LSB to MSB, each bit write at a positive pulse
-	void lsb_shift_out(uint8_t a) {
-		for(uint8_t i = 8; i; --i) {
-			if (a & 0x01)
-				aaz::setpin(DS);
-			else
-				aaz::clrpin(DS);
-			a >>= 1;
-			sclk_ppulse();
-			//_delay_us(1);
-		}
-	}	
+	inline void lsb_shift_out(uint8_t a) {
+		serial_bus::write(a);
+	}
 
 	inline void double_byte_shift_lsb(uint8_t a, uint8_t b) {
 		lsb_shift_out(a);
@@ -98,81 +217,360 @@ namespace shiftdrv {
 
 namespace rtcdrv {
 	//RTC DS1302 driver
-	inline void start_transfer() {
-		aaz::setpin(CE_1302);
-		_NOP();
-	}
 	
-	inline void end_transfer() {
-		aaz::clrpin(CE_1302);
-		_NOP();
-	}
+	//scope guard, CE is high during a transfer.
+	typedef aaz::sbus::select<CE_1302, true, bus_timing> RtcSession;
 	
-	//scope guard
-	class RtcSession {
-	public:
-		RtcSession() {
-			start_transfer();
-		}
-		~RtcSession() {
-			end_transfer();
-		}
-	};
-	
-	/* addr is the command byte, not the exact register address.
-	   therefore the addr differs in read and write operation, 
+	/* command bytes, not the exact register addresses,
+	   therefore they differ in read and write operation,
 	   read DS1302 datasheet Table3 for detail.
 	*/
+	constexpr uint8_t WRITE_SECOND = 0x80;       //0 resets the countdown chain, the rest should be written within 1 second.
+	constexpr uint8_t WRITE_MINUTE = 0x82;
+	constexpr uint8_t WRITE_HOUR = 0x84;
+	constexpr uint8_t WRITE_CONTROL = 0x8e;
+	constexpr uint8_t CLOCK_BURST_READ = 0xbf;
+	
+	//control register value.
+	constexpr uint8_t WRITE_PROTECT = 0x80;
+	
 	void single_write(uint8_t addr, uint8_t data) {
 		RtcSession rs;
 		shiftdrv::lsb_shift_out(addr);
 		shiftdrv::lsb_shift_out(data);
 	}
 	
-	void single_read(uint8_t addr, uint8_t &data_out) {
+	//read a byte after the command byte, DS should be input.
+	//DS1302 puts next bit on DS at each negative edge, and keeps going in burst mode.
+	inline void lsb_shift_in(uint8_t &data_out) {
+		data_out = serial_bus::read();
+	}
+	
+	//clock registers in burst order, all BCD.
+	struct snapshot {
+		uint8_t second;    //MSB is CH (clock halt) flag.
+		uint8_t minute;
+		uint8_t hour;      //MSB is 12-hour mode flag, bit 5 is PM in 12-hour mode.
+	};
+	
+	/* read seconds, minutes and hours in one clock burst read.
+	*  DS1302 copies time registers to a secondary buffer when the burst starts,
+	*  so the three values are coherent even if a rollover happens during the transfer.
+	*  the burst is cut after hours by ending the transfer.
+	*/
+	void read_snapshot(snapshot &s_out) {
 		RtcSession rs;
-		shiftdrv::lsb_shift_out(addr);
+		shiftdrv::lsb_shift_out(CLOCK_BURST_READ);
 		
-		aaz::clr_pins_out(DS);
-		for(uint8_t i = 8; i; --i) {
-			data_out >>= 1;
-			if(aaz::test_pin(DS_IN))    //read DS at negative edge.
-				data_out |= 0x80;
-			
-			shiftdrv::sclk_ppulse(); 
+		serial_bus::release();
+		lsb_shift_in(s_out.second);
+		lsb_shift_in(s_out.minute);
+		lsb_shift_in(s_out.hour);
+		serial_bus::drive();
+	}
+}
+
+
+namespace rtcq {
+#if CLK_RTC_QUEUE
+	/* DS1302 transactions queued by the main loop and run one per display step,
+	*  right after a digit is latched, so the display never waits for the RTC.
+	*
+	*  a transaction raises RCLK/CE, which latches the 595 shift register: it holds the digit just latched,
+	*  thus the display doesn't change. the bits shifted while CE is high are garbage for the 595,
+	*  so the frame is shifted in again after each transaction, and a later CE rise latches the same digit.
+	*  the longest transaction (clock burst read) takes ~0.4ms, well in a display step.
+	*
+	*  register writes and clock burst reads only, nothing needs a single register read.
+	*  an entry is two bytes and has no callback pointer, the 64 bytes of RAM of the attiny13a can't spare more.
+	*/
+	
+	//command byte of clock burst read, the result goes to 'snap' and snapshot_done() is called.
+	constexpr uint8_t SNAPSHOT = rtcdrv::CLOCK_BURST_READ;
+	
+	struct request {
+		uint8_t cmd;     //DS1302 write command byte, or SNAPSHOT.
+		uint8_t data;    //byte to write, or tag passed to snapshot_done().
+	};
+	
+	//enough for time upload (3 writes) plus write protection, the largest batch.
+	constexpr uint8_t QUEUE_SIZE = 4;
+	
+	//first one runs next, the rest move down after it, which needs no head index.
+	request queue[QUEUE_SIZE];
+	uint8_t count = 0;
+	
+	rtcdrv::snapshot snap;    //result of SNAPSHOT.
+	
+	//defined by the application, tag tells which SNAPSHOT request is done.
+	void snapshot_done(uint8_t tag);
+	
+	//false if the queue is full, nothing queued.
+	bool post(uint8_t cmd, uint8_t data = 0) {
+		if(count == QUEUE_SIZE)
+			return false;
+		queue[count].cmd = cmd;
+		queue[count].data = data;
+		++count;
+		return true;
+	}
+	
+	inline bool idle() {
+		return count == 0;
+	}
+	
+	//run the first queued transaction, returns false if there was none.
+	//call right after a 595 latch, and shift the frame in again when true.
+	bool step() {
+		if(!count)
+			return false;
+		
+		request r = queue[0];
+		--count;
+		for(uint8_t i = 0; i != count; ++i)
+			queue[i] = queue[i + 1];
+		
+		if(r.cmd == SNAPSHOT) {
+			rtcdrv::read_snapshot(snap);
+			snapshot_done(r.data);
+		}
+		else {
+			rtcdrv::single_write(r.cmd, r.data);
+		}
+		return true;
+	}
+#else
+	/* without the queue (CLK_RTC_QUEUE), a transaction runs where it is posted, as the clock did before rtcq.
+	*  a blank frame is shifted in first, so its CE rise latches no digit rather than bits of a key read
+	*  or of the transaction before, the display is dark until the next display step.
+	*/
+	constexpr uint8_t SNAPSHOT = rtcdrv::CLOCK_BURST_READ;
+	
+	rtcdrv::snapshot snap;
+	
+	void snapshot_done(uint8_t tag);
+	
+	//always true, there is nothing to be full.
+	__attribute__((noinline)) bool post(uint8_t cmd, uint8_t data = 0) {
+		shiftdrv::double_byte_shift_lsb(0x00, 0x00);    //no digit selected.
+		if(cmd == SNAPSHOT) {
+			rtcdrv::read_snapshot(snap);
+			snapshot_done(data);
+		}
+		else {
+			rtcdrv::single_write(cmd, data);
 		}
-		aaz::set_pins_out(DS);
+		return true;
+	}
+	
+	inline bool idle() {
+		return true;
+	}
+	
+	inline bool step() {
+		return false;
+	}
+#endif
+}
+
+
+#if CLK_KEY_165
+namespace hc165drv {
+	//74HC165 parallel-in shift register driver on the serial bus.
+	//SH/LD on LOAD_165, CLK on SCLK, CLK INH to GND, QH to DS through a 4.7k resistor,
+	//so the MCU and DS1302 override it whenever they drive DS.
+	//SCLK pulses shift the 595 chain as well, which is harmless, every display step shifts a whole frame before latching.
+	
+	typedef aaz::sbus::strobe<LOAD_165, false, bus_timing> load;
+	static_assert(LOAD_165 != CE_1302 && LOAD_165 != RCLK_595, "a RTC transaction or a digit latch would load the 74HC165.");
+	
+	/* latch all parallel inputs, then shift N chained chips out in one transfer,
+	*  the load is part of every read, so no RTC transaction or digit latch comes between it and the shift.
+	*  out[0] is the chip whose QH drives DS.
+	*  H comes out first, so input H is bit 0 and input A is bit 7 of each byte.
+	*/
+	template<uint8_t N>
+	void read(uint8_t (&out)[N]) {
+		load::pulse();
+		serial_bus::release();
+		for(uint8_t i = 0; i != N; ++i)
+			out[i] = serial_bus::read();
+		serial_bus::drive();
+	}
+	
+	inline uint8_t read() {
+		uint8_t b[1];
+		read(b);
+		return b[0];
+	}
+}
+#endif
+
+
+//soft timer tick is timer0 overflow, F_CPU / 8 / 256 == 1.7ms at 1.2MHz, F_CPU / 64 / 256 at 9.6MHz.
+//timer0 counts at 150kHz at most, which telemetry baud rate and light curve (in ticks) are made for.
+constexpr auto TICK_CLKDIV = (F_CPU / 8 <= 150000UL) ? aaz::t0::timer0_clkdiv::div_8 :
+                             (F_CPU / 64 <= 150000UL) ? aaz::t0::timer0_clkdiv::div_64 : aaz::t0::timer0_clkdiv::div_256;
+
+//8-bit key and Vcc readings, 300kHz (div_4) at 1.2MHz.
+constexpr auto ADC_CLKDIV = aaz::adc::calc_clkdiv(300000UL);
+
+
+#if CLK_PROF
+#	if CLK_TELEMETRY && RAMEND <= 0x9f
+#		error "profiling table and telemetry buffer don't fit in 64 bytes of RAM together."
+#	endif
+
+enum prof_section : uint8_t {
+	PROF_DISPLAY = 0,
+	PROF_SYNC,
+	PROF_RTC_STEP,
+	PROF_TX_ISR,
+	PROF_SECTIONS,
+};
+
+//min / max / total timer0 ticks (8 cycles at 1.2MHz, see TICK_CLKDIV) per section.
+aaz::prof::stat prof_table[PROF_SECTIONS];
+
+#	define CLK_PROF_SCOPE(section) aaz::prof::scope prof_scope(prof_table[section])
+#else
+#	define CLK_PROF_SCOPE(section)
+#endif
+
+
+namespace telemetry {
+#if CLK_TELEMETRY
+	/* records are sent in background on TELEMETRY_TX, 8N1 LSB first, decoded by tools/telemetry.cpp:
+	*      0xa5, type, payload..., checksum (8-bit sum of type and payload)
+	*  multi-byte fields are little endian.
+	*
+	*  == type  |  payload ==
+	*     boot   |  MCUSR at reset
+	*     stats  |  counters_t, sent at every RTC sync
+	*     key    |  key_code of a tap
+	*     prof   |  section id, aaz::prof::stat, one section per stats record in turn (CLK_PROF)
+	*     vcc    |  supply tier, bandgap reading, at each tier change (CLK_VCC)
+	*
+	*  a record which doesn't fit in the transmit buffer is dropped and counted.
+	*/
+	constexpr uint8_t SYNC_BYTE = 0xa5;
+	
+	enum class record : uint8_t {
+		boot = 0x01,
+		stats,
+		key,
+		prof,
+		vcc,
+	};
+	
+	struct counters_t {
+		uint16_t syncs;          //RTC syncs since reset.
+		uint8_t corrections;     //syncs finding the minute moved by other than one step.
+		uint8_t keys;            //key taps since reset.
+		uint16_t ticks;          //soft timer ticks passed since last stats record.
+		uint16_t blanks;         //digit blanks (dimming) since last stats record.
+		uint8_t stack_free;      //stack low-water mark, bytes never used.
+		uint8_t drops;           //records dropped for a full buffer.
+	};
+	
+	static_assert(sizeof(counters_t) == 10, "stats payload layout is shared with tools/telemetry.cpp.");
+	
+	counters_t counters;
+	
+	//1.2MHz / 8 / 31 = 4839 baud, timer0 prescaler is the soft timer one.
+	constexpr uint32_t BAUD = 4800;
+	constexpr uint32_t TIMER0_HZ = aaz::t0::calc_freq(TICK_CLKDIV);
+	constexpr uint8_t BIT_TICKS = (TIMER0_HZ + BAUD / 2) / BAUD;
+	static_assert(TIMER0_HZ * 50 >= BIT_TICKS * BAUD * 49 && TIMER0_HZ * 50 <= BIT_TICKS * BAUD * 51,
+	              "telemetry baud rate is off by more than 2% at this clock.");
+	
+	//profiling sends a second record right after stats, which needs a larger buffer.
+	aaz::suart::tx<TELEMETRY_TX, BIT_TICKS, CLK_PROF ? 32 : 16> uart;
+	
+	void send(record type, const void *payload, uint8_t n) {
+		uint8_t r[sizeof(counters_t) + 3];
+		const uint8_t *p = static_cast<const uint8_t *>(payload);
+		uint8_t sum = static_cast<uint8_t>(type);
+		
+		r[0] = SYNC_BYTE;
+		r[1] = sum;
+		for(uint8_t i = 0; i != n; ++i)
+			sum += r[2 + i] = p[i];
+		r[2 + n] = sum;
+		
+		if(!uart.put(r, n + 3))
+			++counters.drops;
 	}
 	
-	void read_hour(uint8_t &h_out) {
-		single_read(0x85, h_out);
+	inline void boot(uint8_t reset_flags) {
+		send(record::boot, &reset_flags, 1);
 	}
 	
-	void write_hour(uint8_t h) {
-		single_write(0x84, h);
+	inline void key(uint8_t code) {
+		++counters.keys;
+		send(record::key, &code, 1);
 	}
 	
-	void read_minute(uint8_t &m_out) {
-		single_read(0x83, m_out);
+	inline void tick() {
+		++counters.ticks;
 	}
 	
-	void write_minute(uint8_t m) {
-		single_write(0x82, m);
+	inline void blank() {
+		++counters.blanks;
 	}
 	
-	//set second register to 0 and reset countdown chain, 
-	//other register operation should be done in 1 second.
-	inline void reset_second() {
-		single_write(0x80, 0x00);
+	inline void sync(bool corrected) {
+		++counters.syncs;
+		if(corrected)
+			++counters.corrections;
+		counters.stack_free = aaz::stack::unused();
+		send(record::stats, &counters, sizeof(counters));
+		counters.ticks = 0;
+		counters.blanks = 0;
+#if CLK_PROF
+		static uint8_t section = 0;
+		struct __attribute__((packed)) {
+			uint8_t id;
+			aaz::prof::stat s;
+		} p;
+		p.id = section;
+		cli();    //the ISR section is updated in interrupt.
+		p.s = prof_table[section];
+		sei();
+		static_assert(sizeof(p) <= sizeof(counters_t), "prof record exceeds the record buffer in send().");
+		send(record::prof, &p, sizeof(p));
+		section = (section + 1 == PROF_SECTIONS) ? 0 : section + 1;
+#endif
 	}
 	
-	inline void clr_write_protection() {
-		single_write(0x8e, 0x00);
+	inline void vcc(uint8_t tier, uint8_t reading) {
+		uint8_t p[2] = {tier, reading};
+		send(record::vcc, p, 2);
 	}
 	
-	inline void set_write_protection() {
-		single_write(0x8e, 0x80);
+	//a record is on the line, cpu should stay in idle sleep.
+	inline bool busy() {
+		return uart.busy();
 	}
+	
+	//timer0 compare B fragment, see aaz/isr_chain.h.
+	struct tx_irq {
+		static inline void on_irq() {
+			CLK_PROF_SCOPE(PROF_TX_ISR);
+			uart.on_compare();
+		}
+	};
+#else
+	//hooks compile to nothing.
+	inline void boot(uint8_t) {}
+	inline void key(uint8_t) {}
+	inline void tick() {}
+	inline void blank() {}
+	inline void sync(bool) {}
+	inline void vcc(uint8_t, uint8_t) {}
+	inline bool busy() { return false; }
+	struct tx_irq;
+#endif
 }
 
 /* 
@@ -182,7 +580,7 @@ namespace rtcdrv {
 *  ---ӦȡADC 
 *  ---RTC˳ģʽ
 *  -ʾѭ
-*  ---watchdog ʱRTC
+*  ---soft timer ʱRTC
 *  ---̬ʾ
 *
 *  
@@ -198,30 +596,29 @@ namespace rtcdrv {
 *  ûаʱADC 뱻Vcc
 *  ѯADSC ADC ڵģʽCPU ѭ̬ܣѹ
 *  
-*  ʾѭʹWatchdog ʱȡRTCȡM ֵǰһλȡM ֵȽϣνͬʱٶʱ+1M 59 0 ʱСʱH 
+*  ʾѭʹsoft timer ʱburst ģʽһζȡRTC 롢MСʱHɶȡµóȫʾֵֵ仯ʱŸʾ
 *  
-*  RTC 12СʱģʽУֵRTC Уʮλ͸λֳλBCD ֱڸλ͵λ洢ƬڲΪת룬λBCD 뵽ֽڴ洢
+*  RTC 12СʱģʽУֵRTC Уʮλ͸λֳλBCD ֱڸλ͵λ洢ƬڲͬλBCD 洢һֽУתʱٷֱȡλ͵λ
 */
 
 struct {
 	//MSB of hour is 12-hour mode flag, which is set to one.
 	uint8_t hour = 0x83;
-	// only low 4 bit is valid, minute number is represented by two BCD.
-	uint8_t minute_ten = 0x01;
-	uint8_t minute_one = 0x05;
+	//two BCD, ten in high half and one in low half, the same as RTC minute register.
+	aaz::packed::nibbles minute = {0x15};
 	
-} clk_cache; // = {0x83, 0x01, 0x05};
+} clk_cache; // = {0x83, 0x15};
 
 //bit at pm_mark_pos of hour indicates pm(1)/am(0)
 constexpr int PM_MARK_POS = 5;
 
 
 //convert hour number from two BCD to hex format
-//only affect low 4 bit, high half as-is.
-void hour_bcd_to_hex() {
-	//clk_cache.hour = low_half(h);
-	if(clk_cache.hour & 0x10)
-		clk_cache.hour += 10;
+//hour number goes to low 4 bit with BCD ten (bit 4) cleared, 12-hour and PM flags as-is.
+uint8_t hour_bcd_to_hex(uint8_t h) {
+	if(h & 0x10)
+		h += 10 - 0x10;
+	return h;
 }
 
 uint8_t hour_hex_to_bcd(uint8_t h) {
@@ -254,12 +651,471 @@ constexpr auto PM_SIGN_POS = (sizeof(seg7_tbl) - 2);
 constexpr auto AM_SIGN_POS = (sizeof(seg7_tbl) - 1);
 
 
-inline uint8_t seg7_code_of(uint8_t pos) {
+//not inlined, one call per digit is smaller than the flash read at each.
+__attribute__((noinline)) uint8_t seg7_code_of(uint8_t pos) {
 	return pgm_read_byte(&seg7_tbl[pos]);
 }
 
 uint8_t seg7_display_cache[4] = {0x03, 0x31, 0x03, 0x03};
 
+#if CLK_SEG_SCAN
+/* segment-major scan, a step drives one segment line low and lights it on every digit showing that segment.
+*  the frame is transposed here whenever seg7_display_cache changes, a step only picks its line:
+*  seg7_line_cache[n] holds the digit mask (0x80 >> digit, as a digit-major step) of segment bit 0x80 >> n.
+*
+*  == per step / frame  | digit-major               | segment-major ==
+*     steps per frame   | 4, 146Hz                  | 8 (DP included), 73Hz
+*     bits shifted      | 16 per step, 64 a frame   | 16 per step, 128 a frame
+*     LEDs lit at once  | 0 - 8, on one digit line  | 0 - 4, on one segment line
+*     peak current      | 8x segment current        | 4x segment current
+*     duty of an LED    | 1/4                       | 1/8
+*  both 595s sit in one chain, so a step shifts two bytes either way, a frame costs twice the shifting.
+*  the transposition is 32 bit tests (~200 cycles) per change of the cache, about once a minute in clock routine.
+*  with digit-major the digit line's 595 output sags with the segments lit (an '8' dimmer than a '1'),
+*  here a line carries 4 LEDs at most, so the sag is half and doesn't follow the digit shown.
+*  LEDs get half the average current at the same resistors, and below 73Hz it would flicker,
+*  so the refresh period stays one tick at every display level, dimming is duty alone.
+*/
+constexpr uint8_t SCAN_STEPS = 8;
+
+uint8_t seg7_line_cache[SCAN_STEPS];
+
+void display_frame_update() {
+	uint8_t seg = 0x80;
+	for(uint8_t n = 0; n != SCAN_STEPS; ++n, seg >>= 1) {
+		uint8_t digits = 0;
+		for(uint8_t i = 0; i != 4; ++i) {
+			if(!(seg7_display_cache[i] & seg))    //common anode, 0 == segment on.
+				digits |= 0x80 >> i;
+		}
+		seg7_line_cache[n] = digits;
+	}
+}
+#else
+constexpr uint8_t SCAN_STEPS = 4;
+
+//digit-major scan shows seg7_display_cache as it is.
+inline void display_frame_update() {}
+#endif
+
+/* state flags in spare PCMSK bits, pin change interrupt is never enabled, the bits have no other effect.
+*  no RAM, and each flag is set / cleared / tested by a single sbi / cbi / sbis.
+*  PCINT4 and PCINT5 are taken by the ISR flags (blank_flag, tick_flag),
+*  thus PCMSK is never written as a whole, a read-modify-write could lose an ISR flag.
+*/
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT0> lit_flag;       //a digit is lit by 595.
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT1> hide_flag;      //blink_pos is hidden at the moment, toggled by blink().
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT2> tap_flag;       //a key is tapped, cleared by the reader.
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT3> charge_flag;    //light capacitor is charging.
+
+#if CLK_MESSAGES || CLK_VCC || CLK_DIAG
+//out of PCMSK bits, main loop only.
+uint8_t ram_flags = 0;
+#endif
+
+#if CLK_MESSAGES
+namespace seg7txt {
+	/* text rendered to segment codes at compile time, stored in flash as strips in display order,
+	*  a frame is 4 consecutive codes of a strip, copied into seg7_display_cache as-is.
+	*  no glyph lookup or string handling at runtime.
+	*
+	*  SEG7_TEXT(msg_set, "SEt ");     //exactly 4 chars, a single frame.
+	*  SEG7_SCROLL(msg_hi, "HELLo");   //scrolls in from right and out to left, length + 3 frames.
+	*
+	*  flash cost is 4 bytes per static text and length + 6 bytes per scrolling text.
+	*/
+	
+	//segment bits of the reversed (LSB to MSB) encoding above, common anode: 0 == segment on.
+	constexpr uint8_t A = 0x80, B = 0x40, C = 0x20, D = 0x10, E = 0x08, F = 0x04, G = 0x02, DP = 0x01;
+	
+	constexpr uint8_t lit(uint8_t segs) {
+		return static_cast<uint8_t>(~segs);
+	}
+	
+	//unsupported chars fail the build, as the throw is not a constant expression.
+	constexpr uint8_t glyph(char c) {
+		return	(c == '0' || c == 'O') ? lit(A|B|C|D|E|F) :
+				(c == '1') ? lit(B|C) :
+				(c == '2') ? lit(A|B|D|E|G) :
+				(c == '3') ? lit(A|B|C|D|G) :
+				(c == '4') ? lit(B|C|F|G) :
+				(c == '5' || c == 'S') ? lit(A|C|D|F|G) :
+				(c == '6') ? lit(A|C|D|E|F|G) :
+				(c == '7') ? lit(A|B|C) :
+				(c == '8') ? lit(A|B|C|D|E|F|G) :
+				(c == '9') ? lit(A|B|C|D|F|G) :
+				(c == 'A') ? lit(A|B|C|E|F|G) :
+				(c == 'b') ? lit(C|D|E|F|G) :
+				(c == 'C') ? lit(A|D|E|F) :
+				(c == 'c') ? lit(D|E|G) :
+				(c == 'd') ? lit(B|C|D|E|G) :
+				(c == 'E') ? lit(A|D|E|F|G) :
+				(c == 'F') ? lit(A|E|F|G) :
+				(c == 'G') ? lit(A|C|D|E|F) :
+				(c == 'H') ? lit(B|C|E|F|G) :
+				(c == 'h') ? lit(C|E|F|G) :
+				(c == 'I') ? lit(E|F) :
+				(c == 'i') ? lit(C) :
+				(c == 'J') ? lit(B|C|D|E) :
+				(c == 'L') ? lit(D|E|F) :
+				(c == 'n') ? lit(C|E|G) :
+				(c == 'o') ? lit(C|D|E|G) :
+				(c == 'P') ? lit(A|B|E|F|G) :
+				(c == 'r') ? lit(E|G) :
+				(c == 't') ? lit(D|E|F|G) :
+				(c == 'U') ? lit(B|C|D|E|F) :
+				(c == 'u') ? lit(C|D|E) :
+				(c == 'y') ? lit(B|C|D|F|G) :
+				(c == '-') ? lit(G) :
+				(c == '_') ? lit(D) :
+				(c == '.') ? lit(DP) :
+				(c == ' ') ? SEG7_CODE_HIDE :
+				throw "no 7-segment glyph for this char";
+	}
+	
+	template<uint8_t... I>
+	struct indices {};
+	
+	template<uint8_t N, uint8_t... I>
+	struct make_indices : make_indices<N - 1, N - 1, I...> {};
+	
+	template<uint8_t... I>
+	struct make_indices<0, I...> {
+		typedef indices<I...> type;
+	};
+	
+	template<uint8_t Size>
+	struct strip {
+		static constexpr uint8_t size = Size;
+		uint8_t code[Size];
+	};
+	
+	//Len chars padded with Pad blanks at both ends, pos counts in reading order.
+	template<uint8_t Len, uint8_t Pad>
+	constexpr uint8_t glyph_at(const char *s, uint8_t pos) {
+		return (pos < Pad || pos >= Pad + Len) ? SEG7_CODE_HIDE : glyph(s[pos - Pad]);
+	}
+	
+	//strips are stored right to left, the same order as seg7_display_cache.
+	template<uint8_t N, uint8_t Pad, uint8_t... I>
+	constexpr strip<N - 1 + 2 * Pad> render(const char (&s)[N], indices<I...>) {
+		return {{ glyph_at<N - 1, Pad>(s, N - 2 + 2 * Pad - I)... }};
+	}
+}
+
+#define SEG7_TEXT(name, text)                                                              \
+	static_assert(sizeof(text) == 5, "static text is exactly 4 chars, pad with spaces."); \
+	constexpr auto name PROGMEM = seg7txt::render<sizeof(text), 0>(text, seg7txt::make_indices<sizeof(text) - 1>::type())
+
+#define SEG7_SCROLL(name, text)                                                            \
+	constexpr auto name PROGMEM = seg7txt::render<sizeof(text), 3>(text, seg7txt::make_indices<sizeof(text) + 5>::type())
+#endif
+
+#if CLK_MESSAGES || CLK_DIAG
+//clock must not overwrite display cache while a message (or diagnostics page) is shown.
+typedef aaz::packed::ram_flag<ram_flags, 0> message_flag;
+#endif
+
+
+#if CLK_DIAG
+#	if RAMEND <= 0x9f
+#		error "diagnostics block doesn't fit in 64 bytes of RAM next to the clock."
+#	endif
+
+namespace diag {
+	/* diagnostics block at the start of EEPROM, for units back from the field,
+	*  read it out with the programmer (avrdude -U eeprom:r:diag.hex:i) and decode with tools/diagdump.cpp.
+	*  == offset | size | ==
+	*     0      |  1   | MAGIC, anything else is a blank block, which is cleared
+	*     1      |  4   | resets by cause: power-on, external, brown-out, watchdog
+	*     5      |  1   | RTC sync failures: halted or unreadable clock, sync dropped for a full queue
+	*     6      |  1   | last error, diag::error
+	*     7      |  2   | uptime hour of the last error
+	*     9      |  1   | supply tier changes (CLK_VCC)
+	*    10      |  1   | last supply tier, 0 - 4, see vcc_tiers
+	*    11      | 16   | uptime hours, wear leveled over 8 words, see aaz::eep::ring16
+	*  counters saturate at 255, words are little endian.
+	*
+	*  RAM holds the header, changes are batched and written back once an uptime hour (and right after reset),
+	*  one byte per main loop round, only bytes which differ, so the display never waits for EEPROM.
+	*  changes since the last write back are lost with power, it's a coarse record.
+	*  the busiest cell is an uptime word, written once in 8 hours, 100k cycles last ~90 years.
+	*/
+	constexpr uint8_t MAGIC = 0xd2;    //0xd1 had no supply tier bytes, such a block is cleared.
+	
+	enum class error : uint8_t {
+		none = 0,
+		brown_out,       //reset by BOD.
+		watchdog,        //reset by watchdog.
+		rtc_halted,      //CH flag set, DS1302 oscillator has stopped and time is lost.
+		rtc_invalid,     //snapshot is no 12-hour BCD time, bus or wiring fault.
+		sync_dropped,    //RTC queue full at a sync.
+	};
+	
+	struct __attribute__((packed)) header {
+		uint8_t magic;
+		uint8_t resets[4];    //MCUSR bit order.
+		uint8_t sync_failures;
+		error last_error;
+		uint16_t last_error_hour;
+		uint8_t vcc_changes;
+		uint8_t vcc_tier;
+	};
+	
+	static_assert(sizeof(header) == 11, "block layout is shared with tools/diagdump.cpp.");
+	
+	typedef aaz::eep::ring16<sizeof(header), 8> uptime_ring;
+	
+	//dirty bits of the uptime word follow the header ones.
+	constexpr uint8_t UPTIME_LO = sizeof(header);
+	static_assert(UPTIME_LO + 2 <= 16, "dirty bits don't fit in 16.");
+	
+	header block;
+	uint16_t hours;             //uptime.
+	uint8_t slot;               //uptime_ring slot holding 'hours'.
+	uint16_t dirty = 0;         //bytes to write back, bit n is header byte n.
+	uint8_t minutes = 0;        //minute changes seen in this hour.
+	uint8_t last_minute = 0xff;
+	
+	//a write back is going on.
+	typedef aaz::packed::ram_flag<ram_flags, 2> flush_flag;
+	
+	inline void touch(uint8_t offset, uint8_t size = 1) {
+		dirty |= ((1u << size) - 1) << offset;
+	}
+	
+	void count(uint8_t &c) {
+		if(c != 0xff)
+			++c;
+	}
+	
+	void record(error e) {
+		block.last_error = e;
+		block.last_error_hour = hours;
+		touch(offsetof(header, last_error), 3);
+	}
+	
+	//at boot, counts the reset and writes the count back at once.
+	void start(uint8_t reset_flags) {
+		uint8_t *p = reinterpret_cast<uint8_t *>(&block);
+		for(uint8_t i = 0; i != sizeof(header); ++i)
+			p[i] = aaz::eep::read_at(i);
+		if(block.magic != MAGIC) {
+			block = header{};
+			block.magic = MAGIC;
+			touch(0, sizeof(header));
+		}
+		hours = uptime_ring::latest(slot);
+		
+		//the other flags may be left from before a power-on reset.
+		uint8_t causes = (reset_flags & _BV(PORF)) ? _BV(PORF) : reset_flags;
+		for(uint8_t i = 0; i != sizeof(block.resets); ++i) {
+			if(causes & _BV(i)) {
+				count(block.resets[i]);
+				touch(offsetof(header, resets) + i);
+			}
+		}
+		if(causes & _BV(BORF))
+			record(error::brown_out);
+		if(causes & _BV(WDRF))
+			record(error::watchdog);
+		flush_flag::set();
+	}
+	
+	error check(const rtcdrv::snapshot &s) {
+		if(s.second & 0x80)
+			return error::rtc_halted;
+		if(!(s.hour & 0x80) || (s.hour & 0x40) || aaz::low_half(s.hour) > 9
+		   || aaz::high_half(s.minute) > 5 || aaz::low_half(s.minute) > 9)
+			return error::rtc_invalid;
+		uint8_t h = aaz::low_half(hour_bcd_to_hex(s.hour & 0x1f));
+		if(h == 0 || h > 12)
+			return error::rtc_invalid;
+		return error::none;
+	}
+	
+	void sync_failure(error e) {
+		count(block.sync_failures);
+		touch(offsetof(header, sync_failures));
+		record(e);
+	}
+	
+	//supply tier changes are written back with the uptime hour, entering standby at once, the supply may be gone soon.
+	void vcc_tier_changed(uint8_t tier, bool standby) {
+		count(block.vcc_changes);
+		block.vcc_tier = tier;
+		touch(offsetof(header, vcc_changes), 2);
+		if(standby)
+			flush_flag::set();
+	}
+	
+	//uptime is counted from minute changes in RTC reads, a sync every 6.25s (25s at most, or right after each change with CLK_CALIB) sees each of them.
+	void minute_seen(uint8_t minute) {
+		if(minute == last_minute)
+			return;
+		bool first = last_minute == 0xff;
+		last_minute = minute;
+		if(first || ++minutes != 60)
+			return;
+		minutes = 0;
+		++hours;
+		slot = uptime_ring::next(slot);
+		touch(UPTIME_LO, 2);
+		flush_flag::set();
+	}
+	
+	//one byte per call while a write back is going on, false when it's done (last write completed).
+	bool flush_step() {
+		if(!flush_flag::test())
+			return false;
+		if(aaz::eep::now_busy())
+			return true;
+		if(!dirty) {
+			flush_flag::clear();
+			return false;
+		}
+		
+		uint8_t n = 0;
+		while(!(dirty & (1u << n)))
+			++n;
+		dirty &= ~(1u << n);
+		
+		//low byte of the uptime word first, see aaz::eep::ring16.
+		if(n < UPTIME_LO)
+			aaz::eep::update_at(n, reinterpret_cast<uint8_t *>(&block)[n]);
+		else if(n == UPTIME_LO)
+			aaz::eep::update_at(uptime_ring::addr_of(slot), static_cast<uint8_t>(hours));
+		else
+			aaz::eep::update_at(uptime_ring::addr_of(slot) + 1, static_cast<uint8_t>(hours >> 8));
+		return true;
+	}
+}
+#endif
+
+
+namespace calib {
+#if CLK_CALIB
+#	if RAMEND <= 0x9f
+#		error "tick calibration doesn't fit in 64 bytes of RAM with the rest, build for ATtiny25 or larger."
+#	endif
+	/* the soft timer tick is timer0 on the internal RC oscillator, which is a few % off its nominal rate at 25C / 3V,
+	*  and moves with supply voltage and temperature. DS1302 runs on its crystal, so the ticks between two RTC reads
+	*  against the seconds between them give the true tick rate.
+	*
+	*  a read tells which second has begun, not when, each end of a window is up to a second off,
+	*  so a window spans 5 minutes of reads (0.3%). only clock routine syncs are taken, glance mode reads while timer0 halts.
+	*  a gap over 2 minutes between syncs starts a new window, as do entering and leaving glance mode and time upload
+	*  (the second register is reset).
+	*  ticks are counted as dispatched, those lost while a callback runs long are lost for the soft timers too.
+	*
+	*  'scale' is timer0 ticks per nominal tick in 1/1024, each window moves it halfway to what was measured,
+	*  a window more than 12.5% off nominal is dropped. it is kept in EEPROM after the diagnostics block,
+	*  so the first minutes after reset are calibrated too, written only when it moved 0.8% since the last write.
+	*/
+	constexpr uint8_t EEP_ADDR = 32;
+	constexpr uint16_t ONE = 1024;
+	constexpr uint16_t MIN_SCALE = ONE - ONE / 8;
+	constexpr uint16_t MAX_SCALE = ONE + ONE / 8;
+	constexpr uint16_t STORE_STEP = 8;
+	constexpr uint16_t WINDOW_S = 300;
+	constexpr uint16_t MAX_GAP_S = 120;
+	constexpr uint16_t NO_STAMP = 0xffff;
+	
+	//nominal ticks per second in 1/64, 37500 at 1.2MHz.
+	constexpr uint32_t TICK_HZ_Q6 = aaz::t0::calc_freq(TICK_CLKDIV) / 4;
+	static_assert((WINDOW_S + MAX_GAP_S) * TICK_HZ_Q6 / 64 * MAX_SCALE < 0xffffffffUL / 2, "window ticks * 1024 overflow.");
+	
+#	if CLK_DIAG
+	static_assert(sizeof(diag::header) + diag::uptime_ring::size <= EEP_ADDR, "calibration overlaps the diagnostics block.");
+#	endif
+	
+	uint16_t scale = ONE;
+	uint16_t stored = 0;            //in EEPROM, 0 for none.
+	uint32_t ticks;                 //since the last read.
+	uint32_t window;                //ticks in the window so far.
+	uint16_t seconds;               //in the window so far.
+	uint16_t last_stamp = NO_STAMP; //second of the hour at the last read.
+	uint8_t store_bytes = 0;        //write back: bit 0 low byte, bit 1 high byte, bit 2 the last write done.
+	
+	void start() {
+		uint16_t v = aaz::eep::read16_at(EEP_ADDR);
+		if(v >= MIN_SCALE && v <= MAX_SCALE)
+			scale = stored = v;
+	}
+	
+	inline void tick() {
+		++ticks;
+	}
+	
+	inline void restart() {
+		last_stamp = NO_STAMP;
+	}
+	
+	//a good snapshot, BCD minute and second.
+	void seen(const rtcdrv::snapshot &s) {
+		if(s.second & 0x80) {
+			restart();
+			return;
+		}
+		uint16_t stamp = (aaz::high_half(s.minute) * 10 + aaz::low_half(s.minute)) * 60
+		               + aaz::high_half(s.second) * 10 + aaz::low_half(s.second);
+		uint16_t gap = (stamp >= last_stamp) ? stamp - last_stamp : stamp + 3600 - last_stamp;
+		bool first = last_stamp == NO_STAMP;
+		last_stamp = stamp;
+		uint32_t n = ticks;
+		ticks = 0;
+		if(first || gap > MAX_GAP_S) {
+			window = 0;
+			seconds = 0;
+			return;
+		}
+		
+		window += n;
+		seconds += gap;
+		if(seconds < WINDOW_S)
+			return;
+		
+		uint32_t expected = (seconds * TICK_HZ_Q6 + 32) >> 6;
+		uint32_t m = (window * ONE + expected / 2) / expected;
+		window = 0;
+		seconds = 0;
+		if(m < MIN_SCALE || m > MAX_SCALE)
+			return;
+		scale = stored ? (scale + static_cast<uint16_t>(m) + 1) / 2 : static_cast<uint16_t>(m);
+		if(scale >= stored + STORE_STEP || scale + STORE_STEP <= stored) {
+			stored = scale;
+			store_bytes = 0x07;
+		}
+	}
+	
+	//one byte per call while a write back is going on, false when it's done (last write completed).
+	bool flush_step() {
+		if(!store_bytes)
+			return false;
+		if(aaz::eep::now_busy())
+			return true;
+		if(store_bytes & 0x01)
+			aaz::eep::update_at(EEP_ADDR, static_cast<uint8_t>(stored));
+		else if(store_bytes & 0x02)
+			aaz::eep::update_at(EEP_ADDR + 1, static_cast<uint8_t>(stored >> 8));
+		store_bytes &= store_bytes - 1;    //lowest bit done.
+		return store_bytes != 0;
+	}
+	
+	//nominal ticks (ticks_of_ms) to timer0 ticks at the measured rate.
+	inline aaz::stimer::tick_t calibrated(aaz::stimer::tick_t nominal) {
+		return static_cast<aaz::stimer::tick_t>((static_cast<uint32_t>(nominal) * scale + ONE / 2) >> 10);
+	}
+#else
+	inline void start() {}
+	inline void tick() {}
+	inline void restart() {}
+	inline void seen(const rtcdrv::snapshot &) {}
+	inline bool flush_step() { return false; }
+	constexpr aaz::stimer::tick_t calibrated(aaz::stimer::tick_t nominal) { return nominal; }
+#endif
+}
+
 constexpr uint8_t NUM_POS_HOUR = 3;
 constexpr uint8_t NUM_POS_SIGN = 2;
 constexpr uint8_t NUM_POS_MINUTE_TEN = 1;
@@ -267,32 +1123,37 @@ constexpr uint8_t NUM_POS_MINUTE_ONE = 0;
 constexpr uint8_t MAX_NUM_POS = NUM_POS_HOUR;
 
 void display_cache_update() {
+#if CLK_MESSAGES || CLK_DIAG
+	if(message_flag::test())
+		return;
+#endif
 	if(at_pm())
 		seg7_display_cache[NUM_POS_SIGN] = seg7_code_of(PM_SIGN_POS);
 	else
 		seg7_display_cache[NUM_POS_SIGN] = seg7_code_of(AM_SIGN_POS);
 	
 	seg7_display_cache[NUM_POS_HOUR] = seg7_code_of(aaz::low_half(clk_cache.hour));
-	seg7_display_cache[NUM_POS_MINUTE_TEN] = seg7_code_of(clk_cache.minute_ten);
-	seg7_display_cache[NUM_POS_MINUTE_ONE] = seg7_code_of(aaz::low_half(clk_cache.minute_one));
+	seg7_display_cache[NUM_POS_MINUTE_TEN] = seg7_code_of(clk_cache.minute.hi());
+	seg7_display_cache[NUM_POS_MINUTE_ONE] = seg7_code_of(clk_cache.minute.lo());
+	display_frame_update();
 }
 
 void time_number_inc(uint8_t pos) {
 	switch(pos) {
 		case (NUM_POS_MINUTE_ONE):
-			if(clk_cache.minute_one == 9) {
-				clk_cache.minute_one = 0;
+			if(clk_cache.minute.lo() == 9) {
+				clk_cache.minute.set_lo(0);
 			}
 			else {
-				++clk_cache.minute_one;
+				++clk_cache.minute.raw;    //low half is below 9, no carry.
 				break;
 			}
 		case (NUM_POS_MINUTE_TEN):
-			if(clk_cache.minute_ten == 5) {
-				clk_cache.minute_ten = 0;
+			if(clk_cache.minute.hi() == 5) {
+				clk_cache.minute.set_hi(0);
 			}
 			else {
-				++clk_cache.minute_ten;
+				clk_cache.minute.raw += 0x10;    //high half is below 5, no carry.
 				break;
 			}
 		case (NUM_POS_HOUR):
@@ -310,33 +1171,87 @@ void time_number_inc(uint8_t pos) {
 	}
 }
 
-void minute_inc() {
-	time_number_inc(NUM_POS_MINUTE_ONE);
+//derive the whole clock cache from a RTC snapshot.
+inline void load_snapshot(const rtcdrv::snapshot &s) {
+	clk_cache.hour = hour_bcd_to_hex(s.hour);
+	clk_cache.minute.raw = s.minute;
 }
 
-void load_clk() {
-	rtcdrv::read_hour(clk_cache.hour);
-	hour_bcd_to_hex();
-	rtcdrv::read_minute(clk_cache.minute_one);
-	clk_cache.minute_ten = aaz::high_half(clk_cache.minute_one);
-	clk_cache.minute_one &= 0x0f;
+//tags of rtcq::SNAPSHOT requests.
+constexpr uint8_t SNAP_LOAD = 0;
+constexpr uint8_t SNAP_SYNC = 1;
+
+void load_clk_done() {
+	load_snapshot(rtcq::snap);
 	display_cache_update();
 }
 
+//clock shows up after the next display step.
+void load_clk() {
+	rtcq::post(rtcq::SNAPSHOT, SNAP_LOAD);
+}
+
+//second register is reset first, the rest is written within a few display steps.
 void upload_clk_config() {
-	rtcdrv::reset_second();
-	rtcdrv::write_hour(hour_hex_to_bcd(clk_cache.hour));
-	rtcdrv::write_minute(clk_cache.minute_ten << 4 | clk_cache.minute_one);
+	calib::restart();
+	rtcq::post(rtcdrv::WRITE_SECOND, 0x00);
+	rtcq::post(rtcdrv::WRITE_HOUR, hour_hex_to_bcd(clk_cache.hour));
+	rtcq::post(rtcdrv::WRITE_MINUTE, clk_cache.minute.raw);
 }
 
+#if CLK_CALIB
+void sync_at_minute(uint8_t second);
+#endif
+
+//clock cache follows RTC as a whole, so missed syncs and hour rollovers are corrected at once.
+//the display cache is derived again at every sync, smaller than telling whether anything has changed,
+//which only telemetry needs (and compiles out without it).
+void sync_done() {
+	uint8_t expected_one = (clk_cache.minute.lo() == 9) ? 0 : clk_cache.minute.lo() + 1;
+	bool changed = hour_bcd_to_hex(rtcq::snap.hour) != clk_cache.hour || rtcq::snap.minute != clk_cache.minute.raw;
+	{
+		CLK_PROF_SCOPE(PROF_SYNC);
+		load_clk_done();
+	}
+	telemetry::sync(changed && clk_cache.minute.lo() != expected_one);
+#if CLK_CALIB
+	sync_at_minute(rtcq::snap.second);
+#endif
+}
+
+//a sync skipped for a full queue is caught up by the next one.
+#if CLK_VCC
+void vcc_step();
+#endif
+
 void sync_time() {
-	uint8_t tmp;
-	rtcdrv::read_minute(tmp);
-	tmp &= 0x0f;
-	if(tmp != clk_cache.minute_one) {
-		minute_inc();
-		display_cache_update();
+#if CLK_VCC
+	vcc_step();
+#endif
+#if CLK_DIAG
+	if(!rtcq::post(rtcq::SNAPSHOT, SNAP_SYNC))
+		diag::sync_failure(diag::error::sync_dropped);
+#else
+	rtcq::post(rtcq::SNAPSHOT, SNAP_SYNC);
+#endif
+}
+
+void rtcq::snapshot_done(uint8_t tag) {
+#if CLK_DIAG
+	//a snapshot which is no time is not loaded, the clock keeps what it has until a good one.
+	diag::error e = diag::check(rtcq::snap);
+	if(e != diag::error::none) {
+		diag::sync_failure(e);
+		return;
+	}
+	diag::minute_seen(rtcq::snap.minute);
+#endif
+	if(tag == SNAP_SYNC) {
+		calib::seen(rtcq::snap);    //clock routine only, timer0 runs between these.
+		sync_done();
 	}
+	else
+		load_clk_done();
 }
 
 /*
@@ -348,31 +1263,363 @@ void display() {
 }
 */
 
-void display_with_hide(uint8_t hide_pos) {
-	for(uint8_t i = 0, mask = 0x80; i != 4; ++i, mask >>= 1) {
-		if(i == hide_pos)
-			shiftdrv::double_byte_shift_lsb(SEG7_CODE_HIDE, mask);
-		else
-			shiftdrv::double_byte_shift_lsb(seg7_display_cache[i], mask);
-			
+uint8_t blink_pos = NUM_POS_SIGN;    //position to blink, hidden while hide_flag is set.
+uint8_t scan_pos = 0;
+
+//light one digit (one segment line with CLK_SEG_SCAN) per call, a whole frame takes SCAN_STEPS calls.
+//the step stays lit by 595 until next call.
+//a queued RTC transaction goes right after the step, see rtcq.
+void display_step() {
+	uint8_t i = scan_pos;
+#if CLK_SEG_SCAN
+	uint8_t code = static_cast<uint8_t>(~(0x80 >> i));
+	uint8_t mask = seg7_line_cache[i];
+	if(hide_flag::test())
+		mask &= ~(0x80 >> blink_pos);
+#else
+	uint8_t code = (i == blink_pos && hide_flag::test()) ? SEG7_CODE_HIDE : seg7_display_cache[i];
+	uint8_t mask = 0x80 >> i;
+#endif
+	{
+		CLK_PROF_SCOPE(PROF_DISPLAY);
+		shiftdrv::double_byte_shift_lsb(code, mask);
 		shiftdrv::rclk_ppulse();
+		scan_pos = (i + 1) & (SCAN_STEPS - 1);
+		lit_flag::set();
 	}
+	
+	if(rtcq::idle())
+		return;
+	CLK_PROF_SCOPE(PROF_RTC_STEP);
+	rtcq::step();
+	shiftdrv::double_byte_shift_lsb(code, mask);    //restore the frame, without latching.
 }
 
-inline void display() {
-	display_with_hide(0xff);
+#if CLK_LIGHT || CLK_VCC
+//turn the lit digit off before next step, for dimming.
+void display_blank() {
+	if(!lit_flag::test())
+		return;
+	shiftdrv::double_byte_shift_lsb(SEG7_CODE_HIDE, 0x00);
+	shiftdrv::rclk_ppulse();
+	lit_flag::clear();
+}
+#endif
+
+void blink() {
+#if CLK_MESSAGES || CLK_DIAG
+	if(message_flag::test())
+		return;
+#endif
+	if(hide_flag::test())
+		hide_flag::clear();
+	else
+		hide_flag::set();
+}
+
+void key_scan();
+#if CLK_LIGHT
+void light_step();
+#	define CLK_LIGHT_TIMER , light_step
+#else
+#	define CLK_LIGHT_TIMER
+#endif
+#if CLK_MESSAGES
+void message_step();
+#	define CLK_MESSAGE_TIMER , message_step
+#else
+#	define CLK_MESSAGE_TIMER
+#endif
+
+
+
+constexpr aaz::stimer::tick_t ticks_of_ms(float ms) {
+	return static_cast<aaz::stimer::tick_t>(ms / aaz::t0::calc_max_duration(TICK_CLKDIV) + 0.5f);
+}
+
+//timer id == position of the callback in 'timers'.
+constexpr uint8_t TIMER_REFRESH  = 0;
+constexpr uint8_t TIMER_KEY_SCAN = 1;
+constexpr uint8_t TIMER_BLINK    = 2;
+constexpr uint8_t TIMER_SYNC     = 3;
+//optional features append their timers.
+constexpr uint8_t TIMER_LIGHT    = 4;
+constexpr uint8_t TIMER_MESSAGE  = TIMER_LIGHT + CLK_LIGHT;
+
+aaz::stimer::wheel<display_step, key_scan, blink, sync_time CLK_LIGHT_TIMER CLK_MESSAGE_TIMER> timers;
+
+constexpr aaz::stimer::tick_t REFRESH_TICKS    = 1;                   //one step per tick, ~146Hz frame rate (73Hz segment-major).
+constexpr aaz::stimer::tick_t KEY_SCAN_TICKS   = ticks_of_ms(16);
+constexpr aaz::stimer::tick_t EDIT_BLINK_TICKS = ticks_of_ms(160);
+constexpr aaz::stimer::tick_t PM_BLINK_TICKS   = ticks_of_ms(250);
+constexpr aaz::stimer::tick_t SYNC_TICKS       = ticks_of_ms(6250);    //several times a minute.
+constexpr aaz::stimer::tick_t LIGHT_TICKS      = ticks_of_ms(2000);
+constexpr aaz::stimer::tick_t SECOND_TICKS     = ticks_of_ms(1000);
+
+//periodic soft timer, nominal ticks taken at the calibrated tick rate.
+//not inlined, the slot stores are larger than a call at each of the callers.
+__attribute__((noinline)) void start_every(uint8_t id, aaz::stimer::tick_t nominal) {
+	aaz::stimer::tick_t t = calib::calibrated(nominal);
+	timers.start(id, t, t);
+}
+
+#if CLK_CALIB
+//next sync a quarter second after the coming minute change, instead of several times a minute.
+//an early one reads the last seconds of the minute and comes again right after, the periodic sync stays behind it.
+void sync_at_minute(uint8_t second) {
+	uint8_t s = aaz::high_half(second) * 10 + aaz::low_half(second);
+	if(s >= 60)
+		return;
+	aaz::stimer::tick_t t = (60 - s) * SECOND_TICKS + ticks_of_ms(250);
+	timers.start(TIMER_SYNC, calib::calibrated(t), timers.period(TIMER_SYNC));
+}
+#endif
+
+//peripheral state of each operating mode, switched with aaz::cfg::apply<to, from>().
+//time edit: timer0 ticks the soft timers, ADC reads keys (F_ADC = 1200 / 4 = 300kHz, see ADC_CLKDIV).
+#if CLK_KEY_165
+constexpr aaz::cfg::mode edit_mode = aaz::cfg::reset_state
+	.without_adc(!CLK_LIGHT)
+	.with_timer0(TICK_CLKDIV, aaz::t0::calc_timer0_intmask(true, false, false))
+	.without_watchdog();
+#else
+constexpr aaz::cfg::mode edit_mode = aaz::cfg::reset_state
+	.with_adc(aaz::adc::adc_mux::pb3, ADC_CLKDIV, CLK_KEY_QUIET)
+	.with_timer0(TICK_CLKDIV, aaz::t0::calc_timer0_intmask(true, false, false))
+	.without_watchdog();
+#endif
+
+//clock routine: keys are kept for glance mode and diagnostics, otherwise ADC is off (and shut down without light sensing).
+#if CLK_CLOCK_KEYS
+constexpr aaz::cfg::mode clock_mode = edit_mode;
+#else
+constexpr aaz::cfg::mode clock_mode = edit_mode.without_adc(!CLK_LIGHT);
+#endif
+
+#if CLK_GLANCE
+//glance: the watchdog wakes the cpu from power down, timer0 interrupts are off.
+//timer0 halts in power down, but a pending overflow would wake the cpu right after sleeping.
+constexpr aaz::cfg::mode glance_mode = clock_mode
+	.with_timer0(TICK_CLKDIV, 0x00)
+	.with_watchdog(aaz::wdt::wdt_mode::interrupt, aaz::wdt::wdt_prescaler::cycle_1s);
+static_assert(!(glance_mode.wdtcr & _BV(WDE)), "glance mode would reset the system on the watchdog.");
+static_assert(!(glance_mode.timsk0 & _BV(TOIE0)), "the soft timer tick would wake glance mode.");
+#endif
+
+//the watchdog is never a system reset source here, applying a mode from reset turns off WDE left by a watchdog reset.
+static_assert(!(edit_mode.wdtcr & _BV(WDE)) && !(clock_mode.wdtcr & _BV(WDE)), "a run mode would reset the system on the watchdog.");
+
+//pending tick and blank request are flag bits in PCMSK, set by naked ISRs (12 cycles instead of 34).
+//pin change interrupt is never enabled, the bits have no other effect.
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT5> tick_flag;
+typedef aaz::isr::io_flag<aaz::isr::io_pcmsk, PCINT4> blank_flag;
+
+//ISR bodies are composed from the fragments of the features using each vector, see aaz/isr_chain.h.
+//a digit is shown right after overflow, and blanked at compare match A when dimmed.
+AAZ_ISR_COMPOSE_FLAGS(iv_timer0_overflow, tick_flag)
+AAZ_ISR_COMPOSE_FLAGS(iv_timer0_oca, aaz::isr::when<CLK_LIGHT || CLK_VCC, blank_flag>)
+
+//the flag ISRs above are naked, 12 cycles each by construction, and cannot hold a profiling scope.
+#if CLK_TELEMETRY
+AAZ_ISR_COMPOSE(iv_timer0_ocb, telemetry::tx_irq)
+#endif
+
+//one round of main loop, shared by time edit mode and normal clock routine.
+void run_once() {
+	if(timers.dispatch_flag<tick_flag>()) {
+		telemetry::tick();
+		calib::tick();
+	}
+#if CLK_LIGHT || CLK_VCC
+	if(blank_flag::test()) {
+		blank_flag::clear();
+		display_blank();
+		telemetry::blank();
+	}
+#endif
+#if CLK_DIAG
+	diag::flush_step();
+#endif
+	calib::flush_step();
 }
 
 
-volatile uint8_t timer_interrupt_counter = 0;
-volatile bool blink_flag = true;
+#if CLK_LIGHT || CLK_VCC
+//lit part of a tick in 1/256 and ticks per digit at each display level, picked by ambient light and supply voltage.
+//less LED current and less shifting at higher levels, 73Hz frame rate at the slowest.
+const uint8_t display_duty_tbl[] PROGMEM    = {0xff, 0x80, 0x30, 0x10};
+#if CLK_SEG_SCAN
+const uint8_t display_refresh_tbl[] PROGMEM = {1, 1, 1, 1};    //already at 73Hz.
+#else
+const uint8_t display_refresh_tbl[] PROGMEM = {1, 1, 2, 2};
+#endif
+constexpr uint8_t DISPLAY_LEVELS = sizeof(display_duty_tbl);
+static_assert(sizeof(display_refresh_tbl) == DISPLAY_LEVELS, "one duty and refresh entry per display level.");
 
-ISR(iv_wdt) {
-	aaz::wdt::reset();
-	timer_interrupt_counter++;
-	blink_flag = !blink_flag;
-	aaz::adc::start();
+uint8_t display_level = 0;
+
+void apply_display_level(uint8_t level) {
+	if(level == display_level)
+		return;
+	display_level = level;
+	
+	uint8_t duty = pgm_read_byte(&display_duty_tbl[level]);
+	aaz::t0::set_ocr0a_val(duty);
+	aaz::t0::set_compare_a_interrupt(duty != 0xff);    //OCIE0B may be sending telemetry.
+	
+	uint8_t period = pgm_read_byte(&display_refresh_tbl[level]);
+	timers.start(TIMER_REFRESH, period, period);
 }
+#endif
+
+
+#if CLK_VCC
+/* supply tiers, each one keeps what the ones before do:
+*  == tier | below | ==
+*     1    | 3.0V  | display level 1, half duty.
+*     2    | 2.8V  | display level 2, slower refresh.
+*     3    | 2.6V  | RTC synced 4 times less often.
+*     4    | 2.4V  | glance display (standby) once, a key brings the clock back, DS1302 keeps time down to 2.0V.
+*  3% hysteresis, tested with tools/vcctiers.cpp (keep the thresholds there the same).
+*/
+typedef aaz::vcc::tiers<5, 3000, 2800, 2600, 2400> vcc_tiers;
+
+constexpr uint8_t VCC_MAX_DISPLAY_LEVEL = 2;
+constexpr uint8_t VCC_RARE_SYNC         = 3;
+constexpr uint8_t VCC_STANDBY           = 4;
+static_assert(vcc_tiers::levels == VCC_STANDBY + 1, "one tier per threshold above.");
+
+uint8_t vcc_tier = 0;
+
+//glance display is entered from main loop.
+typedef aaz::packed::ram_flag<ram_flags, 1> standby_flag;
+
+#	if CLK_LIGHT
+uint8_t light_level = 0;
+#	endif
+
+//light and supply voltage ask for a display level each, the higher one (less current) is taken.
+void update_display_level() {
+	uint8_t level = (vcc_tier < VCC_MAX_DISPLAY_LEVEL) ? vcc_tier : VCC_MAX_DISPLAY_LEVEL;
+#	if CLK_LIGHT
+	if(light_level > level)
+		level = light_level;
+#	endif
+	apply_display_level(level);
+}
+
+//bandgap on the ADC mux with Vcc reference, busy conversions without interrupt,
+//which also works in CLK_KEY_165 builds, there is no ISR(iv_adc) there.
+constexpr aaz::cfg::mode vcc_mode = clock_mode
+	.with_adc(aaz::adc::adc_mux::bandgap, ADC_CLKDIV, false);
+
+//sampled before each RTC sync, 5 conversions, ~0.25ms.
+void vcc_step() {
+	using namespace aaz;
+	
+	cfg::apply<vcc_mode, clock_mode>();
+	uint8_t r = adc::read_vcc8<2>();
+	cfg::apply<clock_mode, vcc_mode>();
+	
+	uint8_t tier = vcc_tiers::next(vcc_tier, r);
+	if(tier == vcc_tier)
+		return;
+	vcc_tier = tier;
+	telemetry::vcc(tier, r);
+#	if CLK_DIAG
+	diag::vcc_tier_changed(tier, tier == VCC_STANDBY);
+#	endif
+	update_display_level();
+	
+	start_every(TIMER_SYNC, (tier >= VCC_RARE_SYNC) ? SYNC_TICKS * 4 : SYNC_TICKS);
+	if(tier == VCC_STANDBY)
+		standby_flag::set();
+}
+#elif CLK_LIGHT
+uint8_t &light_level = display_level;    //light alone picks the display level.
+#endif
+
+
+#if CLK_LIGHT
+//light level curve over capacitor charge time in ticks (~1.7ms), bright to dark.
+//with 1uF, 1k (daylight) charges within a tick, 1M (dark room) takes ~240 ticks.
+//tested with tools/lightcurve.cpp (keep the thresholds and filter there the same).
+typedef aaz::ambient::curve<2, 3, 12, 48> light_curve;
+static_assert(light_curve::levels == DISPLAY_LEVELS, "one display level per light level.");
+
+aaz::ambient::lpf<2> light_filter;
+uint8_t light_count = 0;
+
+//capacitor stays discharged (LIGHT_IN output low) between measurements,
+//released to charge through the photoresistor, then checked every tick until it passes the bandgap.
+void light_step() {
+	using namespace aaz;
+	
+	if(!charge_flag::test()) {
+		acmp::set_acsr(acmp::acmp_trigger::on_change, false, true, true);
+		clr_pins_out(LIGHT_IN);
+		light_count = 0;
+		charge_flag::set();
+		timers.start(TIMER_LIGHT, 1, 1);
+		return;
+	}
+	
+	//comparator output stays high while LIGHT_IN is below bandgap.
+	if(acmp::output() && ++light_count != 0xff)
+		return;
+	
+	acmp::disable();
+	set_pins_out(LIGHT_IN);
+	charge_flag::clear();
+	timers.start(TIMER_LIGHT, calib::calibrated(LIGHT_TICKS));
+#	if CLK_VCC
+	light_level = light_curve::next(light_level, light_filter.update(light_count));
+	update_display_level();
+#	else
+	apply_display_level(light_curve::next(light_level, light_filter.update(light_count)));
+#	endif
+}
+#endif
+
+
+#if CLK_MESSAGES
+//a frame is a plain 4-byte copy from flash, ~40 cycles, whatever the text is.
+constexpr aaz::stimer::tick_t MESSAGE_FRAME_TICKS = ticks_of_ms(150);
+
+SEG7_SCROLL(msg_set, "SEt");
+
+const uint8_t *message_strip;
+uint8_t message_pos;
+
+//frames from the right end of the strip down to offset 0, then back to clock.
+void message_step() {
+	if(message_pos == 0xff) {
+		timers.stop(TIMER_MESSAGE);
+		message_flag::clear();
+		display_cache_update();
+		return;
+	}
+	memcpy_P(seg7_display_cache, message_strip + message_pos, 4);
+	display_frame_update();
+	--message_pos;
+}
+
+void message_start(const uint8_t *strip, uint8_t last_frame) {
+	message_strip = strip;
+	message_pos = last_frame;
+	message_flag::set();
+	hide_flag::clear();
+	message_step();
+	start_every(TIMER_MESSAGE, MESSAGE_FRAME_TICKS);
+}
+
+//show a SEG7_TEXT / SEG7_SCROLL strip.
+template<uint8_t Size>
+inline void message_play(const seg7txt::strip<Size> &s) {
+	static_assert(Size >= 4 && Size < 0xff, "strip holds 4 to 254 codes.");
+	message_start(s.code, Size - 4);
+}
+#endif
 
 enum class key_code: uint8_t {
 	no_key = 0x0,
@@ -381,123 +1628,381 @@ enum class key_code: uint8_t {
 	key_t,
 };
 
-volatile bool key_tapped = false;
-volatile key_code key_last = key_code::no_key;
-volatile key_code key = key_code::no_key;
+//keys are read in main loop (soft timer callback), no volatile needed.
+//last two readings, the current one in low half, the one before in high half.
+aaz::packed::nibbles key_state;
+
+inline key_code key_now() {
+	return static_cast<key_code>(key_state.lo());
+}
+
+inline key_code key_before() {
+	return static_cast<key_code>(key_state.hi());
+}
+
+//pressed keys as a bit mask, one bit per key, any number of them at once.
+constexpr uint8_t KEY_BIT_A = 1 << 0;
+constexpr uint8_t KEY_BIT_B = 1 << 1;
+constexpr uint8_t KEY_BIT_T = 1 << 2;
+
+//T over B over A when more than one is pressed.
+constexpr key_code key_of(uint8_t pressed) {
+	return (pressed & KEY_BIT_T) ? key_code::key_t :
+	       (pressed & KEY_BIT_B) ? key_code::key_b :
+	       (pressed & KEY_BIT_A) ? key_code::key_a : key_code::no_key;
+}
+
+#if CLK_KEY_165
+//buttons pull 74HC165 inputs low (10k pull-ups), one transfer reads them all, no ADC conversion.
+//A, B, T on inputs H, G, F.
+inline key_code key_read() {
+	return key_of(~hc165drv::read());
+}
+#else
+#if CLK_KEY_QUIET
+//conversion is waited in ADC noise reduction sleep, the interrupt is only there to wake cpu up.
+EMPTY_INTERRUPT(iv_adc);
+#endif
+
+/* 10k pull-up from Vcc to KEY_IN, each key pulls KEY_IN to GND through its own resistor,
+*  A 15k, B 5.6k, T 1.3k, in KEY_BIT order, the values in the readme.
+*  their readings are also inside the bands of the fixed thresholds (62 / 124 / 185) before this decoder.
+*  only 8-bit of adc result is used (left aligned), readings are ratiometric, thus the same at any Vcc:
+*  == key    | reading | level from ==
+*     T      |    29   |     0
+*     B      |    91   |    60
+*     A      |   153   |   122
+*   no_key   |   255   |   204
+*  levels are kept 24 codes apart at least, thresholds (midpoints), guard bands and the
+*  check of all 256 readings are worked out by the decoder at compile time.
+*  add a key by adding its resistor here and a KEY_BIT, nothing else changes.
+*/
+//tested with tools/keyladder.cpp (keep the resistors there the same).
+typedef aaz::ladder::decoder<8, 24, 10000, 15000, 5600, 1300> key_ladder;
+
+//key_of() for the decoder, which maps each level to its key code at compile time.
+constexpr uint8_t key_value_of(uint8_t pressed) {
+	return static_cast<uint8_t>(key_of(pressed));
+}
+
+//timer0 halts in noise reduction sleep, which would stretch a telemetry bit on the line.
+template<uint8_t Log2N = 0>
+inline uint8_t key_adc_read() {
+	if(!CLK_KEY_QUIET || telemetry::busy())
+		return aaz::adc::read8_busy<Log2N>();
+	return aaz::adc::read8_quiet<Log2N>();
+}
+
+//one conversion is enough away from thresholds (low latency),
+//4 averaged conversions are taken only when the reading is in a guard band (precision, CLK_KEY_OVERSAMPLE).
+key_code key_read() {
+	uint8_t r = key_adc_read();
+#if CLK_KEY_OVERSAMPLE
+	uint8_t level = key_ladder::find(r);
+	if(key_ladder::near_threshold(r, level))
+		level = key_ladder::find(key_adc_read<2>());
+	
+	return key_of(key_ladder::mask_at(level));
+#else
+	return static_cast<key_code>(key_ladder::decode_as<key_value_of>(r));
+#endif
+}
+#endif
+
+void key_scan() {
+	key_state.shift_in(static_cast<uint8_t>(key_read()));
+	
+	if(key_now() != key_before() && key_before() == key_code::no_key) {
+		tap_flag::set();
+		telemetry::key(key_state.lo());
+	}
+}
+
+
+#if CLK_GLANCE
+/* glance mode, the 595s hold a latched digit by themselves, no multiplexing needed to show it.
+*  the cpu stays in power down, the watchdog wakes it once a second to latch the next digit:
+*  hour, am/pm, minute ten, minute one, then a blank second, in which RTC is read for a new minute.
+*  any key held at a wake-up goes back to multiplexing.
+*
+*  the cpu draws a few uA of watchdog current instead of running timer0 and idle sleep all the time,
+*  LEDs draw what one lit digit does, nothing in the blank second.
+*/
+constexpr uint8_t GLANCE_FRAMES = 5;    //4 digits and a blank.
+
+EMPTY_INTERRUPT(iv_wdt);
 
-ISR(iv_adc) {
-	//only use 8-bit of adc result (left aligned), thus the range is [0 - 255]
-	//threshold voltage level of each key at 3.3V Vcc:
-	//== key		|  threshold volt	| adc result ==
-	//  no_key		|     > 2.4			|    185
-	//    A			|     < 2.4			|    185
-	//    B			|     < 1.6			|    124
-	//    T			|     < 0.8			|     62
+void glance() {
+	using namespace aaz;
+	
+	//timer0 halts in power down, which would stretch a telemetry bit on the line.
+	while(telemetry::busy())
+		run_once();
+	
+	cfg::apply<glance_mode, clock_mode>();
+	calib::restart();    //timer0 halts in power down.
+	
+	uint8_t frame = 0;
+	key_code k;
+	do {
+		uint8_t code = SEG7_CODE_HIDE;
+		uint8_t mask = 0x00;
+		if(frame != GLANCE_FRAMES - 1) {
+			uint8_t pos = MAX_NUM_POS - frame;
+			code = seg7_display_cache[pos];
+			mask = 0x80 >> pos;
+		}
+		shiftdrv::double_byte_shift_lsb(code, mask);
+		shiftdrv::rclk_ppulse();
+		
+		//as in display_step(): each CE rise latches the frame just shown, which is shifted in again after every transaction.
+		//the key read after wake-up clocks the 595 chain too, but a whole frame goes in before the next latch.
+		if(frame == GLANCE_FRAMES - 1)
+			rtcq::post(rtcq::SNAPSHOT, SNAP_LOAD);
+		while(rtcq::step())
+			shiftdrv::double_byte_shift_lsb(code, mask);
+#if CLK_DIAG
+		//an EEPROM write keeps the clock running, power down would not be entered entirely.
+		while(diag::flush_step());
+#endif
+		while(calib::flush_step());
+		frame = (frame + 1 == GLANCE_FRAMES) ? 0 : frame + 1;
+		
+#if !CLK_KEY_165
+		adc::disable();
+#endif
+		cli();
+		sei_and_sleep_as(sleep_mode_enum::power_down);
+#if !CLK_KEY_165
+		adc::enable();
+#endif
+		k = key_read();
+	} while(k == key_code::no_key);
+	
+	cfg::apply<clock_mode, glance_mode>();
+	calib::restart();
+#if CLK_LIGHT || CLK_VCC
+	t0::set_compare_a_interrupt(display_level != 0);    //TIMSK0 is written as a whole by apply().
+#endif
 	
-	uint8_t r = ADCH;
-	key_last = key;
-	if(r < 62) {    //T
-		key = key_code::key_t;
+	//the key is still held, no tap until it is released.
+	key_state.raw = static_cast<uint8_t>(k) << 4 | static_cast<uint8_t>(k);
+	tap_flag::clear();
+	lit_flag::set();
+}
+#endif
+
+
+#if CLK_DIAG
+/* diagnostics pages, key B in the clock routine shows the first one, key B goes on, key A (or the last page) back to clock.
+*  page number on the left, value in 3 decimal digits, 999 at most:
+*  == page | value ==
+*     0    | uptime in days
+*     1-4  | resets: power-on, external, brown-out, watchdog
+*     5    | RTC sync failures
+*     6    | last error, diag::error
+*     7    | hours since the last error
+*/
+constexpr uint8_t DIAG_PAGES = 8;
+
+uint16_t diag_value(uint8_t page) {
+	using namespace diag;
+	
+	switch(page) {
+		case 0:
+			return hours / 24;
+		case 5:
+			return block.sync_failures;
+		case 6:
+			return static_cast<uint8_t>(block.last_error);
+		case 7:
+			return hours - block.last_error_hour;
+		default:
+			return block.resets[page - 1];
 	}
-	else if(r < 124) {  // B
-		key = key_code::key_b;
+}
+
+void diag_show(uint8_t page) {
+	uint16_t v = diag_value(page);
+	if(v > 999)
+		v = 999;
+	seg7_display_cache[MAX_NUM_POS] = seg7_code_of(page);
+	for(uint8_t i = 0; i != MAX_NUM_POS; ++i) {
+		seg7_display_cache[i] = seg7_code_of(v % 10);
+		v /= 10;
 	}
-	else if(r < 185) {    //A
-		key = key_code::key_a;
-	}		
-	else{
-		key = key_code::no_key;
+	display_frame_update();
+}
+
+void diag_dump() {
+	message_flag::set();
+	hide_flag::clear();
+	
+	uint8_t page = 0;
+	diag_show(page);
+	while(true) {
+		run_once();
+		if(!tap_flag::test())
+			continue;
+		tap_flag::clear();
+		if(key_now() != key_code::key_b || ++page == DIAG_PAGES)
+			break;
+		diag_show(page);
 	}
 	
-	if(key != key_last && key_last == key_code::no_key)
-		key_tapped = true;
+	message_flag::clear();
+	display_cache_update();
 }
+#endif
+
 
+//state n edits number position n, minute one first, A moves on and sends the time past the hour, B moves back and drops it past minute one.
+typedef aaz::fsm::machine<aaz::fsm::cursor_edit<MAX_NUM_POS + 1>> edit_fsm;
+
+//a tap is never no_key, key_code - 1 is the event.
+static_assert(static_cast<uint8_t>(key_code::key_a) - 1 == edit_fsm::rules::forward &&
+              static_cast<uint8_t>(key_code::key_b) - 1 == edit_fsm::rules::back &&
+              static_cast<uint8_t>(key_code::key_t) - 1 == edit_fsm::rules::change, "key codes don't match edit events.");
 
 void time_edit() {
-	int8_t editing_pos = 0;    // editing position at the four values ([ hour | AM/PM | minute_ten | minute_one ])
-	constexpr uint8_t editing_blink_time = 10;    //16ms * 31  0.5s
+	uint8_t editing_pos = edit_fsm::rules::first;    // editing position at the four values ([ hour | AM/PM | minute_ten | minute_one ])
 	
-	while(true) {
-		if(timer_interrupt_counter > editing_blink_time)    //number at editing position blink over time.
-			display_with_hide(editing_pos);
-		else
-			display();
+#if CLK_MESSAGES
+	message_play(msg_set);
+#endif
+	blink_pos = editing_pos;    //number at editing position blink over time.
+	start_every(TIMER_KEY_SCAN, KEY_SCAN_TICKS);
+	start_every(TIMER_BLINK, EDIT_BLINK_TICKS);
 	
-		aaz::counter_reset_when(timer_interrupt_counter, editing_blink_time * 2);
+	while(true) {
+		run_once();    //sleeps until any interrupt, key reading and blink included.
 		
-		if(key_tapped) {
-			key_tapped = false;
-			
-			switch(key) {
-				case (key_code::key_a):    //A
-					if(++editing_pos > MAX_NUM_POS) {
-						//send time config
-						hour_mark_12();
-						upload_clk_config();
-						return;
-					}
-					break;
-				case (key_code::key_b):    //B
-					if(--editing_pos < 0) {
-						//skip_menu
-						load_clk();
-						return;
-					}
-					break;
-				case (key_code::key_t):    //T
-					time_number_inc(editing_pos);
-					display_cache_update();
-					break;
-				
-				case (key_code::no_key):
-					;
-			}
+		if(!tap_flag::test())
+			continue;
+		tap_flag::clear();
+		
+		//one table step per tap.
+		aaz::fsm::step s = edit_fsm::at(editing_pos, static_cast<uint8_t>(key_now()) - 1);
+		editing_pos = s.next;
+		switch(s.action) {
+			case (edit_fsm::rules::commit):
+				//send time config
+				hour_mark_12();
+				upload_clk_config();
+				return;
+			case (edit_fsm::rules::cancel):
+				//skip_menu
+				load_clk();
+				return;
+			case (edit_fsm::rules::apply):
+				time_number_inc(editing_pos);
+				display_cache_update();
+				break;
 		}
+		
+		//show the new number or position at once, then blink from there.
+		blink_pos = editing_pos;
+		hide_flag::clear();
 	}
 }
 
 
+//highest interrupt vector with a handler above, the minimal startup (AAZ_LAST_VECTOR) may cut the table after it.
+constexpr uint8_t CLK_LAST_VECTOR = !CLK_KEY_165 && CLK_KEY_QUIET ? ADC_vect_num :
+                                    CLK_GLANCE ? WDT_vect_num :
+                                    CLK_TELEMETRY ? TIM0_COMPB_vect_num : TIM0_COMPA_vect_num;
+#ifdef AAZ_LAST_VECTOR
+static_assert(CLK_LAST_VECTOR <= AAZ_LAST_VECTOR, "an interrupt in use is cut from the vector table, raise AAZ_LAST_VECTOR.");
+#endif
+
+
+AAZ_NORETURN_MAIN int main();
+
 int main() {
 	using namespace aaz;
 	
+#if CLK_TELEMETRY
+	stack::paint();
+	set_pins_out(TELEMETRY_TX);    //line idles high.
+#endif
+#if CLK_TELEMETRY || CLK_DIAG
+	uint8_t reset_flags = wdt::take_reset_flags();
+#else
 	wdt::after_sys_reset();
-	set_ddr(SCLK, RCLK_595, DS, CE_1302);
-	
-	//F_CPU = 1.2Mhz  F_ADC = 1200 / 4 = 300kHz
-	adc::set_admux(adc::adc_mux::pb3);
-	adc::set_align_left();
-	//adc::set_prescaler(adc_clkdiv::div_4);
-	//adc::enable_interrupt();
-	//adc::enable();
-	//equivalent operation to the three commented statements above
-	adc::set_and_enable(adc::adc_clkdiv::div_4, true);
-			
+#endif
+#if CLK_KEY_165
+	setpin(LOAD_165);    //74HC165 in shift mode between reads.
+	set_ddr(SCLK, RCLK_595, DS, CE_1302, SPARE, LOAD_165);
+#else
+	set_ddr(SCLK, RCLK_595, DS, CE_1302, SPARE);    //LIGHT_IN low keeps the capacitor discharged.
+#endif
+#if CLK_LIGHT
+	disable_digital_inputs(LIGHT_IN);
+#endif
+	acmp::disable();    //analog comparator is on after reset, only used while measuring light.
+	
+#if !CLK_KEY_165
+	disable_digital_inputs(KEY_IN);
+#endif
+	
+	//ADC, soft timer time base and watchdog off, in one write per register.
+	cfg::apply<edit_mode>();
+#if CLK_DIAG
+	diag::start(reset_flags);
+#endif
+	calib::start();
+	
+	display_frame_update();
+	
+	//both run with the first display steps.
 	load_clk();
-	rtcdrv::clr_write_protection();
-	wdt::run(wdt::wdt_mode::interrupt, wdt::wdt_prescaler::cycle_16ms);
+	rtcq::post(rtcdrv::WRITE_CONTROL, 0x00);
+	
+	timers.start(TIMER_REFRESH, REFRESH_TICKS, REFRESH_TICKS);
+#if CLK_LIGHT
+	timers.start(TIMER_LIGHT, 1);
+#endif
 	sei();
+#if CLK_TELEMETRY
+	telemetry::boot(reset_flags);
+#endif
 	time_edit();
-	rtcdrv::set_write_protection();
+	rtcq::post(rtcdrv::WRITE_CONTROL, rtcdrv::WRITE_PROTECT);
 	
-	cli();
-	//wdt::mute();
-	wdt::run(wdt::wdt_mode::interrupt, wdt::wdt_prescaler::cycle_250ms);
-	adc::disable();
-	sei();
+#if !CLK_CLOCK_KEYS
+	timers.stop(TIMER_KEY_SCAN);
+#endif
+	cfg::apply<clock_mode, edit_mode>();
 	
 	// NORMAL CLOCK routine
 	//AM/PM mark blink overtime, clock sync with ds1302 several times a minute.
+	blink_pos = NUM_POS_SIGN;
+	hide_flag::clear();
+	start_every(TIMER_BLINK, PM_BLINK_TICKS);
+	start_every(TIMER_SYNC, SYNC_TICKS);
 
 	while(true) {
-		if(blink_flag)
-			display();
-		else
-			display_with_hide(NUM_POS_SIGN);
-
-		if(counter_reset_when(timer_interrupt_counter, 25)) {
-			sync_time();
+		run_once();
+#if CLK_CLOCK_KEYS
+		if(tap_flag::test()) {
+			tap_flag::clear();
+			key_code k = key_now();    //glance() leaves the key which brought the clock back.
+#	if CLK_GLANCE
+			if(k == key_code::key_a)
+				glance();
+#	endif
+#	if CLK_DIAG
+			if(k == key_code::key_b)
+				diag_dump();
+#	endif
+		}
+#endif
+#if CLK_VCC
+		if(standby_flag::test()) {
+			standby_flag::clear();
+			glance();
 		}
+#endif
 	}
 	
 }
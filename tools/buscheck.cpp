@@ -0,0 +1,398 @@
+/* buscheck - shared bus timing checker for the 595 / DS1302 RCLK-CE trick.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o buscheck buscheck.cpp
+*
+*  usage:
+*      buscheck [options] trace.txt
+*
+*      --fcpu HZ        cpu clock used to convert cycles to time, default 1200000.
+*      --vcc5           use DS1302 5.0V / 74HC595 4.5V limits instead of the 2.0V ones.
+*      --map FILE       symbol map from 'avr-nm -n -C firmware.elf', resolves pc to call site.
+*      --sclk N --ce N --ds N
+*                       PORTB bit of each bus line, default SCLK = 2, RCLK/CE = 4, DS = 0.
+*      --chain N        bits of the 595 chain, default 16 (two 595s).
+*
+*  trace format, one record per PORTB change, '#' starts a comment:
+*      <cycle> <portb hex> [<pc hex>]
+*  cycle is the cpu cycle count when the new PORTB value takes effect,
+*  pc is the byte address of the instruction which wrote the port (optional).
+*
+*  rules checked:
+*    DS1302 (datasheet AC characteristics)
+*      - SCLK low when CE rises.
+*      - tCWH  CE inactive time before a transfer.
+*      - tCC   CE rise to first SCLK rise.
+*      - tCH / tCL  SCLK high / low time inside a transfer.
+*      - tDC   DS setup to SCLK rise while the MCU drives DS.
+*      - tCDH  DS hold after SCLK rise while the MCU drives DS.
+*      - tCCH  last SCLK edge to CE fall.
+*      - transfer length must be whole bytes and at least command + one data byte.
+*    74HC595 and the shared RCLK/CE line
+*      - tW    SCLK high / low time and RCLK pulse width.
+*      - tsu   DS setup to SCLK rise, last SCLK rise to RCLK rise.
+*      - DS stays quiet during a RCLK pulse. a DS change after the CE rise is only known to be wrong
+*        at the CE fall: a SCLK rise in between makes the pulse a DS1302 transfer, which sets DS for
+*        command bit 0 before the first clock.
+*      - every RCLK/CE rise latches the 595: the shift register must hold a complete frame,
+*        so after a RTC transfer the chain must be rewritten before the next rise.
+*
+*  exit status is the number of violations (capped at 255), 0 when the trace is clean.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	//all limits in nanoseconds
+	struct limits {
+		//DS1302
+		double t_dc, t_cdh, t_cl, t_ch, t_cc, t_cch, t_cwh;
+		//74HC595
+		double t_w, t_su_ds, t_su_rclk;
+	};
+
+	//DS1302 @ 2.0V, 74HC595 @ 2.0V
+	constexpr limits limits_low_vcc  = {200, 280, 1000, 1000, 4000, 240, 4000,  75, 75, 100};
+	//DS1302 @ 5.0V, 74HC595 @ 4.5V
+	constexpr limits limits_high_vcc = { 50,  70,  250,  250, 1000,  60, 1000,  15, 15,  20};
+
+	struct sample {
+		uint64_t cycle;
+		uint8_t port;
+		bool has_pc;
+		uint32_t pc;
+	};
+
+	struct symbol {
+		uint32_t addr;
+		std::string name;
+	};
+
+	struct config {
+		double fcpu = 1200000.0;
+		limits lim = limits_low_vcc;
+		uint8_t sclk = 2, ce = 4, ds = 0;
+		unsigned chain_bits = 16;
+		std::vector<symbol> symbols;
+	};
+
+	std::string call_site(const config &cfg, const sample &s) {
+		if(!s.has_pc)
+			return "<no pc>";
+
+		char buf[32];
+		snprintf(buf, sizeof(buf), "0x%04x", s.pc);
+		std::string r(buf);
+
+		auto it = std::upper_bound(cfg.symbols.begin(), cfg.symbols.end(), s.pc,
+			[](uint32_t a, const symbol &sym) { return a < sym.addr; });
+		if(it != cfg.symbols.begin()) {
+			--it;
+			snprintf(buf, sizeof(buf), "+0x%x", s.pc - it->addr);
+			r += " <" + it->name + buf + ">";
+		}
+		return r;
+	}
+
+	class checker {
+	public:
+		explicit checker(const config &c) : cfg(c) {}
+
+		void feed(const sample &s) {
+			if(!started) {
+				started = true;
+				prev = s;
+				last_ce_fall = last_sclk_rise = last_sclk_fall = last_ds_change = s;
+				return;
+			}
+
+			const uint8_t changed = prev.port ^ s.port;
+			//DS and SCLK before CE, so a CE fall in the same write sees the final bus state.
+			if(changed & _bv(cfg.ds))
+				on_ds_change(s);
+			if(changed & _bv(cfg.sclk)) {
+				if(s.port & _bv(cfg.sclk))
+					on_sclk_rise(s);
+				else
+					on_sclk_fall(s);
+			}
+			if(changed & _bv(cfg.ce)) {
+				if(s.port & _bv(cfg.ce))
+					on_ce_rise(s);
+				else
+					on_ce_fall(s);
+			}
+			prev = s;
+		}
+
+		unsigned violations() const {
+			return count;
+		}
+
+		unsigned transfers() const {
+			return n_transfers;
+		}
+
+		unsigned latches() const {
+			return n_latches;
+		}
+
+	private:
+		static uint8_t _bv(uint8_t b) {
+			return static_cast<uint8_t>(1u << b);
+		}
+
+		double ns_between(const sample &a, const sample &b) const {
+			return (b.cycle - a.cycle) * 1e9 / cfg.fcpu;
+		}
+
+		void report(const sample &at, const char *rule, const std::string &detail) {
+			++count;
+			printf("cycle %llu (%.3f us): %s: %s at %s\n",
+				static_cast<unsigned long long>(at.cycle), at.cycle * 1e6 / cfg.fcpu,
+				rule, detail.c_str(), call_site(cfg, at).c_str());
+		}
+
+		void check_min(const sample &from, const sample &to, double min_ns, const char *rule) {
+			const double t = ns_between(from, to);
+			if(t < min_ns) {
+				char buf[96];
+				snprintf(buf, sizeof(buf), "%.0f ns < %.0f ns min", t, min_ns);
+				report(to, rule, buf);
+			}
+		}
+
+		//MCU drives DS during the command byte, and during data bytes of a write command.
+		bool mcu_drives_ds() const {
+			return bit_index < 8 || !(command & 0x01);
+		}
+
+		void on_ds_change(const sample &s) {
+			if(ce_high) {
+				//not a violation yet, the first SCLK rise may still turn the pulse into a transfer.
+				if(!in_transfer && !ds_changed_in_ce) {
+					ds_changed_in_ce = true;
+					ds_change_in_ce = s;
+				}
+				else if(in_transfer && mcu_drives_ds() && (prev.port & _bv(cfg.sclk)))
+					check_min(last_sclk_rise, s, cfg.lim.t_cdh, "ds1302/tCDH");
+			}
+			last_ds_change = s;
+		}
+
+		void on_sclk_rise(const sample &s) {
+			if(ce_high) {
+				if(!in_transfer) {
+					//first clock inside CE, the pulse turns out to be a RTC transfer.
+					in_transfer = true;
+					++n_transfers;
+					check_min(ce_rise, s, cfg.lim.t_cc, "ds1302/tCC");
+					if(have_ce_fall)
+						check_min(last_ce_fall, ce_rise, cfg.lim.t_cwh, "ds1302/tCWH");
+				}
+				else {
+					check_min(last_sclk_fall, s, cfg.lim.t_cl, "ds1302/tCL");
+				}
+
+				if(mcu_drives_ds())
+					check_min(last_ds_change, s, cfg.lim.t_dc, "ds1302/tDC");
+				if(bit_index < 8 && (s.port & _bv(cfg.ds)))
+					command |= static_cast<uint8_t>(1u << bit_index);
+				++bit_index;
+			}
+			else {
+				check_min(last_sclk_fall, s, cfg.lim.t_w, "595/tW-sclk-low");
+				check_min(last_ds_change, s, cfg.lim.t_su_ds, "595/tsu-ds");
+				++shifts_since_latch;
+				if(frame_dirty && shifts_since_latch >= cfg.chain_bits)
+					frame_dirty = false;
+			}
+			last_sclk_rise = s;
+		}
+
+		void on_sclk_fall(const sample &s) {
+			if(ce_high && in_transfer)
+				check_min(last_sclk_rise, s, cfg.lim.t_ch, "ds1302/tCH");
+			else
+				check_min(last_sclk_rise, s, cfg.lim.t_w, "595/tW-sclk-high");
+			last_sclk_fall = s;
+		}
+
+		void on_ce_rise(const sample &s) {
+			++n_latches;
+			if(s.port & _bv(cfg.sclk))
+				report(s, "ds1302/sclk-low-at-ce", "SCLK high when CE rises");
+
+			//the rise latches whatever the 595 shift register holds.
+			if(frame_dirty) {
+				char buf[96];
+				snprintf(buf, sizeof(buf), "stale RTC bits latched, only %u of %u bits rewritten after transfer",
+					shifts_since_latch, cfg.chain_bits);
+				report(s, "595/frame", buf);
+			}
+			else if(shifts_since_latch % cfg.chain_bits) {
+				char buf[96];
+				snprintf(buf, sizeof(buf), "partial frame latched, %u bits shifted since last latch",
+					shifts_since_latch);
+				report(s, "595/frame", buf);
+			}
+			if(shifts_since_latch)
+				check_min(last_sclk_rise, s, cfg.lim.t_su_rclk, "595/tsu-rclk");
+
+			ce_high = true;
+			in_transfer = false;
+			ce_rise = s;
+			ds_changed_in_ce = false;
+			bit_index = 0;
+			command = 0;
+			shifts_since_latch = 0;
+		}
+
+		void on_ce_fall(const sample &s) {
+			if(in_transfer) {
+				check_min(prev.port & _bv(cfg.sclk) ? last_sclk_rise : last_sclk_fall, s, cfg.lim.t_cch, "ds1302/tCCH");
+				if(bit_index < 16 || bit_index % 8) {
+					char buf[96];
+					snprintf(buf, sizeof(buf), "transfer of %u clocks, command 0x%02x", bit_index, command);
+					report(s, "ds1302/length", buf);
+				}
+				//every clock of the transfer went into the 595 shift register too.
+				frame_dirty = true;
+			}
+			else {
+				check_min(ce_rise, s, cfg.lim.t_w, "595/tW-rclk");
+				if(ds_changed_in_ce)
+					report(ds_change_in_ce, "latch/ds-quiet", "DS changed during RCLK pulse");
+			}
+
+			ce_high = false;
+			in_transfer = false;
+			have_ce_fall = true;
+			last_ce_fall = s;
+		}
+
+		const config &cfg;
+
+		bool started = false;
+		sample prev{};
+		sample ce_rise{}, last_ce_fall{}, last_sclk_rise{}, last_sclk_fall{}, last_ds_change{};
+		bool have_ce_fall = false;
+
+		bool ce_high = false;
+		bool in_transfer = false;
+		bool ds_changed_in_ce = false;    //DS changed before the first SCLK rise of this CE pulse.
+		sample ds_change_in_ce{};
+		unsigned bit_index = 0;
+		uint8_t command = 0;
+
+		unsigned shifts_since_latch = 0;
+		bool frame_dirty = false;
+
+		unsigned count = 0;
+		unsigned n_transfers = 0;
+		unsigned n_latches = 0;
+	};
+
+	bool load_symbols(const char *path, std::vector<symbol> &out) {
+		std::ifstream in(path);
+		if(!in)
+			return false;
+
+		std::string line;
+		while(std::getline(in, line)) {
+			std::istringstream ls(line);
+			std::string addr, type;
+			if(!(ls >> addr >> type))
+				continue;
+			if(type != "t" && type != "T" && type != "W" && type != "w")
+				continue;
+			std::string name;
+			std::getline(ls >> std::ws, name);
+			out.push_back({static_cast<uint32_t>(strtoul(addr.c_str(), nullptr, 16)), name});
+		}
+		std::stable_sort(out.begin(), out.end(),
+			[](const symbol &a, const symbol &b) { return a.addr < b.addr; });
+		return true;
+	}
+
+	bool parse_sample(const std::string &line, sample &s) {
+		std::string body = line.substr(0, line.find('#'));
+		std::istringstream ls(body);
+		std::string cyc, port, pc;
+		if(!(ls >> cyc >> port))
+			return false;
+		s.cycle = strtoull(cyc.c_str(), nullptr, 10);
+		s.port = static_cast<uint8_t>(strtoul(port.c_str(), nullptr, 16));
+		s.has_pc = static_cast<bool>(ls >> pc);
+		s.pc = s.has_pc ? static_cast<uint32_t>(strtoul(pc.c_str(), nullptr, 16)) : 0;
+		return true;
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: buscheck [--fcpu HZ] [--vcc5] [--map FILE] [--sclk N] [--ce N] [--ds N] [--chain N] trace.txt\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	config cfg;
+	const char *trace_path = nullptr;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--fcpu") && has_arg)
+			cfg.fcpu = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--vcc5"))
+			cfg.lim = limits_high_vcc;
+		else if(!strcmp(argv[i], "--map") && has_arg) {
+			if(!load_symbols(argv[++i], cfg.symbols)) {
+				fprintf(stderr, "buscheck: cannot read map %s\n", argv[i]);
+				return 255;
+			}
+		}
+		else if(!strcmp(argv[i], "--sclk") && has_arg)
+			cfg.sclk = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--ce") && has_arg)
+			cfg.ce = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--ds") && has_arg)
+			cfg.ds = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--chain") && has_arg)
+			cfg.chain_bits = static_cast<unsigned>(atoi(argv[++i]));
+		else if(argv[i][0] != '-' && !trace_path)
+			trace_path = argv[i];
+		else {
+			usage();
+			return 255;
+		}
+	}
+	if(!trace_path || cfg.fcpu <= 0 || cfg.chain_bits == 0) {
+		usage();
+		return 255;
+	}
+
+	std::ifstream in(trace_path);
+	if(!in) {
+		fprintf(stderr, "buscheck: cannot read trace %s\n", trace_path);
+		return 255;
+	}
+
+	checker ck(cfg);
+	std::string line;
+	sample s;
+	while(std::getline(in, line)) {
+		if(parse_sample(line, s))
+			ck.feed(s);
+	}
+
+	printf("%u RCLK/CE pulses, %u RTC transfers, %u violations\n", ck.latches(), ck.transfers(), ck.violations());
+	return static_cast<int>(std::min(ck.violations(), 255u));
+}
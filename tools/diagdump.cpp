@@ -0,0 +1,210 @@
+/* diagdump - decoder for the clock's EEPROM diagnostics block (firmware built with CLK_DIAG=1),
+*  and the tick calibration factor (CLK_CALIB=1).
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o diagdump diagdump.cpp
+*
+*  usage:
+*      diagdump [options] [eeprom.hex]
+*
+*      --raw            the image is raw bytes, not Intel HEX (detected anyway when it doesn't start with ':').
+*      -v               print every uptime slot.
+*
+*  reads the image from the file, or from stdin when no file is given, e.g. read out with:
+*      avrdude -c usbasp -p t25 -U eeprom:r:diag.hex:i && diagdump diag.hex
+*
+*  block layout, see namespace diag in main.cpp:
+*      0  magic 0xd2,  1  resets by cause (4),  5  RTC sync failures,  6  last error,  7  hour of last error (2),
+*      9  supply tier changes,  10  last supply tier,
+*     11  uptime hours, 8 little endian words, the highest below 0xff00 is the current one.
+*  a 0xd1 block is the older layout without supply tier bytes, reported as no block.
+*  tick calibration, see namespace calib in main.cpp:
+*     32  timer0 ticks per nominal tick in 1/1024, little endian, 896 - 1152, anything else is none.
+*
+*  exit status is 0 for a decoded block, 1 when the image holds no block (blank or other data), 255 for bad input.
+*/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+namespace {
+	const uint8_t MAGIC = 0xd2;
+	const size_t HEADER_SIZE = 11;
+	const size_t UPTIME_SLOTS = 8;
+	const size_t BLOCK_SIZE = HEADER_SIZE + 2 * UPTIME_SLOTS;
+
+	const size_t CALIB_ADDR = 32;
+	const unsigned CALIB_ONE = 1024;
+
+	//MCUSR bit order.
+	const char *const reset_names[] = {"power-on", "external", "brown-out", "watchdog"};
+
+	//diag::error order in main.cpp.
+	const char *const error_names[] = {"none", "brown_out", "watchdog", "rtc_halted", "rtc_invalid", "sync_dropped"};
+
+	//vcc_tiers in main.cpp.
+	const char *const tier_names[] = {"3.0V and up", "below 3.0V", "below 2.8V", "below 2.6V", "below 2.4V, standby"};
+
+	uint16_t le16(const uint8_t *p) {
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	int hex_digit(int c) {
+		if(c >= '0' && c <= '9')
+			return c - '0';
+		c = toupper(c);
+		if(c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	//data records (type 00) only, unwritten addresses stay 0xff like erased EEPROM.
+	bool parse_ihex(const std::vector<char> &text, std::vector<uint8_t> &image) {
+		size_t i = 0;
+		while(i < text.size()) {
+			if(text[i] != ':') {
+				++i;
+				continue;
+			}
+			++i;
+			std::vector<uint8_t> rec;
+			while(i + 1 < text.size() && hex_digit(text[i]) >= 0 && hex_digit(text[i + 1]) >= 0) {
+				rec.push_back(static_cast<uint8_t>(hex_digit(text[i]) << 4 | hex_digit(text[i + 1])));
+				i += 2;
+			}
+			if(rec.size() < 5 || rec.size() != rec[0] + 5u) {
+				fprintf(stderr, "diagdump: malformed hex record\n");
+				return false;
+			}
+			uint8_t sum = 0;
+			for(uint8_t b : rec)
+				sum += b;
+			if(sum) {
+				fprintf(stderr, "diagdump: hex record checksum mismatch\n");
+				return false;
+			}
+			if(rec[3] == 0x01)
+				break;
+			if(rec[3] != 0x00)
+				continue;
+			size_t addr = static_cast<size_t>(rec[1] << 8 | rec[2]);
+			if(image.size() < addr + rec[0])
+				image.resize(addr + rec[0], 0xff);
+			for(size_t k = 0; k != rec[0]; ++k)
+				image[addr + k] = rec[4 + k];
+		}
+		return true;
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: diagdump [--raw] [-v] [eeprom.hex]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	const char *path = nullptr;
+	bool raw = false;
+	bool verbose = false;
+
+	for(int i = 1; i < argc; ++i) {
+		if(!strcmp(argv[i], "--raw"))
+			raw = true;
+		else if(!strcmp(argv[i], "-v"))
+			verbose = true;
+		else if(argv[i][0] != '-' && !path)
+			path = argv[i];
+		else {
+			usage();
+			return 255;
+		}
+	}
+
+	FILE *in = path ? fopen(path, "rb") : stdin;
+	if(!in) {
+		fprintf(stderr, "diagdump: cannot read %s\n", path);
+		return 255;
+	}
+	std::vector<char> text;
+	int c;
+	while((c = fgetc(in)) != EOF)
+		text.push_back(static_cast<char>(c));
+	if(path)
+		fclose(in);
+
+	std::vector<uint8_t> image;
+	size_t first = 0;
+	while(first < text.size() && isspace(static_cast<unsigned char>(text[first])))
+		++first;
+	if(!raw && first < text.size() && text[first] == ':') {
+		if(!parse_ihex(text, image))
+			return 255;
+	}
+	else {
+		image.assign(text.begin(), text.end());
+	}
+
+	if(image.size() < BLOCK_SIZE) {
+		fprintf(stderr, "diagdump: image is %zu bytes, the block takes %zu\n", image.size(), BLOCK_SIZE);
+		return 255;
+	}
+	const uint8_t *b = image.data();
+	if(image.size() >= CALIB_ADDR + 2) {
+		unsigned scale = le16(b + CALIB_ADDR);
+		if(scale >= CALIB_ONE - CALIB_ONE / 8 && scale <= CALIB_ONE + CALIB_ONE / 8)
+			printf("tick calibration %u/1024, timer0 %+.2f%% off nominal\n", scale,
+			       (static_cast<double>(scale) / CALIB_ONE - 1) * 100);
+		else
+			printf("tick calibration none (0x%04x)\n", scale);
+	}
+
+	if(b[0] != MAGIC) {
+		printf("no diagnostics block (magic 0x%02x, expected 0x%02x)%s\n", b[0], MAGIC,
+		       b[0] == 0xff ? ", EEPROM is blank" : "");
+		return 1;
+	}
+
+	//same pick as aaz::eep::ring16::latest().
+	unsigned hours = 0;
+	size_t slot = UPTIME_SLOTS - 1;
+	for(size_t i = 0; i != UPTIME_SLOTS; ++i) {
+		uint16_t v = le16(b + HEADER_SIZE + 2 * i);
+		if(v < 0xff00 && v >= hours) {
+			hours = v;
+			slot = i;
+		}
+	}
+
+	printf("uptime           %u h (%u d %u h), slot %zu\n", hours, hours / 24, hours % 24, slot);
+	for(size_t i = 0; i != 4; ++i)
+		printf("resets %-9s %u%s\n", reset_names[i], b[1 + i], b[1 + i] == 0xff ? "+" : "");
+	printf("sync failures    %u%s\n", b[5], b[5] == 0xff ? "+" : "");
+
+	const uint8_t err = b[6];
+	const uint16_t err_hour = le16(b + 7);
+	if(err == 0) {
+		printf("last error       none\n");
+	}
+	else {
+		const char *name = err < sizeof(error_names) / sizeof(error_names[0]) ? error_names[err] : "unknown";
+		printf("last error       %s (%u) at hour %u, %u h ago\n", name, err, err_hour,
+		       static_cast<unsigned>(static_cast<uint16_t>(hours - err_hour)));
+	}
+
+	const uint8_t tier = b[10];
+	printf("supply tier      %u (%s), %u%s changes\n", tier,
+	       tier < sizeof(tier_names) / sizeof(tier_names[0]) ? tier_names[tier] : "unknown", b[9], b[9] == 0xff ? "+" : "");
+
+	if(verbose) {
+		for(size_t i = 0; i != UPTIME_SLOTS; ++i) {
+			uint16_t v = le16(b + HEADER_SIZE + 2 * i);
+			printf("  slot %zu: 0x%04x%s%s\n", i, v, v == 0xffff ? " (erased)" : v >= 0xff00 ? " (torn)" : "",
+			       i == slot ? " <-" : "");
+		}
+	}
+	return 0;
+}
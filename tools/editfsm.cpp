@@ -0,0 +1,242 @@
+/* editfsm - runs the firmware's time edit state machine (time_edit() in main.cpp) on host, over every transition
+*  and every key sequence up to a given length.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o editfsm editfsm.cpp
+*
+*  usage:
+*      editfsm [options]
+*
+*      --depth N        longest key sequence, default 10 (3^N sequences).
+*      -v               print the transition table.
+*
+*  the machine is aaz::fsm::cursor_edit from the firmware headers, instantiated as edit_fsm in main.cpp,
+*  and is read through the same packed table the firmware reads from flash.
+*  checks, each failure is printed:
+*      - every state and event leads to a state and an action of the machine, done ignores every event.
+*      - commit only on A at the hour, cancel only on B at minute one, T never moves the cursor.
+*      - every position is reachable from the first one, and done is reachable from each.
+*      - every key sequence gives the same cursor, digit changes and outcome as the hand written loop did
+*        (int8_t position, ++ on A and send past the hour, -- on B and drop past minute one, T changes the digit).
+*
+*  exit status is the number of failures (capped at 255), 0 when the machine passes.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../seg7-595-leddrv/aaz/fsm.h"
+
+namespace {
+	//same as edit_fsm in main.cpp, MAX_NUM_POS is 3.
+	const int8_t MAX_NUM_POS = 3;
+	typedef aaz::fsm::machine<aaz::fsm::cursor_edit<MAX_NUM_POS + 1>> machine;
+	typedef machine::rules rules;
+
+	const char key_names[] = {'A', 'B', 'T'};
+	const char *const action_names[] = {"ignore", "move", "apply", "commit", "cancel"};
+
+	unsigned failures = 0;
+
+	void fail(const char *what, uint8_t s, uint8_t e) {
+		printf("  FAIL: %s, state %u key %c\n", what, s, key_names[e]);
+		++failures;
+	}
+
+	enum class outcome : uint8_t {
+		editing,
+		sent,
+		dropped,
+	};
+
+	struct result {
+		outcome end = outcome::editing;
+		int8_t pos = 0;
+		uint8_t changes[MAX_NUM_POS + 1] = {};
+		unsigned keys = 0;    //keys taken before the end.
+
+		bool operator==(const result &r) const {
+			return end == r.end && pos == r.pos && keys == r.keys && !memcmp(changes, r.changes, sizeof(changes));
+		}
+	};
+
+	//the loop time_edit() was before the table.
+	result hand_written(const uint8_t *seq, unsigned n) {
+		result r;
+		for(unsigned i = 0; i != n && r.end == outcome::editing; ++i, ++r.keys) {
+			switch(seq[i]) {
+				case (0):
+					if(++r.pos > MAX_NUM_POS)
+						r.end = outcome::sent;
+					break;
+				case (1):
+					if(--r.pos < 0)
+						r.end = outcome::dropped;
+					break;
+				case (2):
+					++r.changes[r.pos];
+					break;
+			}
+		}
+		//the position is meaningless once left, compare it as the firmware leaves it.
+		if(r.end != outcome::editing)
+			r.pos = rules::done;
+		return r;
+	}
+
+	result table_driven(const uint8_t *seq, unsigned n) {
+		result r;
+		uint8_t state = rules::first;
+		for(unsigned i = 0; i != n && r.end == outcome::editing; ++i, ++r.keys) {
+			aaz::fsm::step s = machine::at(state, seq[i]);
+			state = s.next;
+			switch(s.action) {
+				case (rules::commit):
+					r.end = outcome::sent;
+					break;
+				case (rules::cancel):
+					r.end = outcome::dropped;
+					break;
+				case (rules::apply):
+					++r.changes[state];
+					break;
+			}
+		}
+		r.pos = static_cast<int8_t>(state);
+		return r;
+	}
+
+	void check_transitions(bool verbose) {
+		if(verbose)
+			printf("state  A               B               T\n");
+		for(uint8_t s = 0; s != rules::states; ++s) {
+			if(verbose)
+				printf("%5u", s);
+			for(uint8_t e = 0; e != rules::events; ++e) {
+				aaz::fsm::step st = machine::at(s, e);
+				if(verbose)
+					printf("  %-6s -> %-4u", st.action < rules::actions ? action_names[st.action] : "?", st.next);
+
+				if(st.next >= rules::states || st.action >= rules::actions)
+					fail("step out of range", s, e);
+				if(s == rules::done && (st.action != rules::ignore || st.next != rules::done))
+					fail("done doesn't ignore the key", s, e);
+				if(s != rules::done && st.action == rules::ignore)
+					fail("key ignored while editing", s, e);
+				if(st.action == rules::commit && !(e == rules::forward && s == rules::done - 1))
+					fail("commit other than A at the hour", s, e);
+				if(st.action == rules::cancel && !(e == rules::back && s == rules::first))
+					fail("cancel other than B at minute one", s, e);
+				if((st.action == rules::commit || st.action == rules::cancel) != (st.next == rules::done && s != rules::done))
+					fail("done entered without commit or cancel", s, e);
+				if(e == rules::change && st.next != s)
+					fail("T moves the cursor", s, e);
+				if(st.action == rules::move && (st.next == s || st.next == rules::done))
+					fail("move doesn't move", s, e);
+			}
+			if(verbose)
+				printf("\n");
+		}
+	}
+
+	void check_reachable() {
+		bool seen[rules::states] = {};
+		uint8_t queue[rules::states];
+		uint8_t head = 0, tail = 0;
+		queue[tail++] = rules::first;
+		seen[rules::first] = true;
+		while(head != tail) {
+			uint8_t s = queue[head++];
+			for(uint8_t e = 0; e != rules::events; ++e) {
+				uint8_t n = machine::at(s, e).next;
+				if(!seen[n]) {
+					seen[n] = true;
+					queue[tail++] = n;
+				}
+			}
+		}
+		for(uint8_t s = 0; s != rules::states; ++s) {
+			if(!seen[s]) {
+				printf("  FAIL: state %u unreachable\n", s);
+				++failures;
+			}
+		}
+
+		//done from each state, by A only or B only, at most one key per position.
+		for(uint8_t s = 0; s != rules::done; ++s) {
+			for(uint8_t e = rules::forward; e <= rules::back; ++e) {
+				uint8_t t = s;
+				for(uint8_t k = 0; k != rules::states && t != rules::done; ++k)
+					t = machine::at(t, e).next;
+				if(t != rules::done)
+					fail("done unreachable by repeating", s, e);
+			}
+		}
+	}
+
+	unsigned check_sequences(unsigned depth) {
+		uint8_t seq[32] = {};
+		unsigned count = 0;
+		for(unsigned n = 0; n <= depth; ++n) {
+			memset(seq, 0, sizeof(seq));
+			while(true) {
+				++count;
+				result a = hand_written(seq, n);
+				result b = table_driven(seq, n);
+				if(!(a == b)) {
+					printf("  FAIL: keys ");
+					for(unsigned i = 0; i != n; ++i)
+						putchar(key_names[seq[i]]);
+					printf(": loop ends %u at %d after %u keys, table ends %u at %d after %u keys\n",
+					       static_cast<unsigned>(a.end), a.pos, a.keys, static_cast<unsigned>(b.end), b.pos, b.keys);
+					++failures;
+				}
+
+				//next sequence of length n, base 3 counting.
+				unsigned i = 0;
+				while(i != n && ++seq[i] == rules::events)
+					seq[i++] = 0;
+				if(i == n)
+					break;
+			}
+		}
+		return count;
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: editfsm [--depth N] [-v]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned depth = 10;
+	bool verbose = false;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--depth") && has_arg)
+			depth = static_cast<unsigned>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "-v"))
+			verbose = true;
+		else {
+			usage();
+			return 255;
+		}
+	}
+	if(depth > 16) {
+		fprintf(stderr, "editfsm: depth %u is more than 16\n", depth);
+		return 255;
+	}
+
+	printf("%u states x %u keys, table %u bytes\n", rules::states, rules::events, machine::size);
+	check_transitions(verbose);
+	check_reachable();
+	unsigned count = check_sequences(depth);
+	printf("%u key sequences up to %u keys\n", count, depth);
+
+	if(failures)
+		fprintf(stderr, "editfsm: %u failures\n", failures);
+	return failures > 255 ? 255 : static_cast<int>(failures);
+}
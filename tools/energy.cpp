@@ -0,0 +1,447 @@
+/* energy - average supply current of the clock per operating mode, estimated from a simulator or pin trace.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o energy energy.cpp
+*
+*  usage:
+*      energy [options] trace.txt
+*
+*      --fcpu HZ        cpu clock, trace cycles are converted to time with it, default 1200000.
+*      --set NAME=MA    current of a table entry in mA, e.g. --set led=3.5, may be repeated.
+*      --list           print the current table and exit.
+*      --sclk N --ce N --ds N
+*                       PORTB bit of each bus line, default SCLK = 2, RCLK/CE = 4, DS = 0.
+*
+*  trace format, one record per line, '#' starts a comment, cycles never go back:
+*      <cycle> <portb hex> [<pc hex>]    PORTB write, the buscheck format, so one trace serves both tools.
+*      <cycle> sleep idle|adc|pdown      cpu enters idle, ADC noise reduction or power down sleep.
+*      <cycle> wake                      cpu runs again.
+*      <cycle> ADCSRA <hex>              register writes, ADC is on while ADEN is set and PRADC clear,
+*      <cycle> PRR <hex>                 watchdog while WDE or WDTIE is set.
+*      <cycle> WDTCR <hex>
+*      <cycle> mode <name>               the time from here on goes to mode <name>, e.g. edit, clock, glance.
+*  cycle counts cpu clocks of wall time, sleep included. with no mode record the whole trace is one mode.
+*  the recorder sets a mode record at time_edit(), the clock routine loop and glance() (breakpoints on the symbols).
+*
+*  the 595 chain is replayed from SCLK / DS / RCLK: each RCLK rise latches the last 16 bits shifted,
+*  the first byte is the segment code (common anode, 0 == segment on) and the second the digit mask,
+*  the same pair display_step() sends. an LED is lit while its segment bit is 0 and its digit bit is 1.
+*  DS1302 is active while CE is high (CE is RCLK), standby otherwise.
+*
+*  the default table is for 3V at 25C from the datasheets, and 2mA per LED, measure the LED current
+*  of your board (resistors, supply) and pass it with --set led=..., it dominates every mode but glance.
+*  the estimate compares builds and modes, it is no meter: 595 output sag, LED forward voltage spread,
+*  and cpu wake-up times are not modeled.
+*
+*  exit status is 0, 255 for bad options or a bad trace.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+	enum entry_id {
+		e_active,
+		e_idle,
+		e_adc_nr,
+		e_pdown,
+		e_adc,
+		e_wdt,
+		e_led,
+		e_rtc_active,
+		e_rtc_standby,
+		e_hc595,
+		e_bod,
+		ENTRIES,
+	};
+
+	struct entry {
+		const char *name;
+		double ma;
+		const char *what;
+	};
+
+	//the cpu states come first, in cpu_state order.
+	entry table[ENTRIES] = {
+		{"active",      0.45,    "cpu running, 1.2MHz"},
+		{"idle",        0.12,    "idle sleep, timer0 running"},
+		{"adc",         0.10,    "ADC noise reduction sleep, ADC itself not included"},
+		{"pdown",       0.0002,  "power down sleep, watchdog not included"},
+		{"adc_on",      0.20,    "ADC enabled"},
+		{"wdt",         0.004,   "watchdog oscillator running"},
+		{"led",         2.0,     "one lit LED segment"},
+		{"rtc_active",  0.4,     "DS1302 while CE is high"},
+		{"rtc_standby", 0.0003,  "DS1302 keeping time"},
+		{"hc595",       0.004,   "two 74HC595s quiescent"},
+		{"bod",         0.0,     "brown-out detector, when the fuse enables it (~0.02)"},
+	};
+
+	enum cpu_state {
+		cpu_active,
+		cpu_idle,
+		cpu_adc,
+		cpu_pdown,
+		CPU_STATES,
+	};
+
+	const char *const cpu_names[] = {"active", "idle", "adc-nr", "power-down"};
+
+	//segment bits of the code byte, see seg7txt in main.cpp.
+	const char *const segment_names[] = {"DP", "G", "F", "E", "D", "C", "B", "A"};
+
+	struct config {
+		double fcpu = 1200000.0;
+		uint8_t sclk = 2, ce = 4, ds = 0;
+	};
+
+	//time (s) spent in each state of a mode, LEDs in LED-seconds.
+	struct totals {
+		std::string name;
+		double cpu[CPU_STATES] = {};
+		double adc_on = 0;
+		double wdt_on = 0;
+		double rtc_active = 0;
+		double led = 0;
+		double segment[8] = {};
+		unsigned peak = 0;
+
+		double time() const {
+			double t = 0;
+			for(double c : cpu)
+				t += c;
+			return t;
+		}
+
+		//average mA of each entry.
+		void currents(double (&out)[ENTRIES]) const {
+			const double t = time();
+			for(int s = 0; s != CPU_STATES; ++s)
+				out[s] = cpu[s] * table[s].ma / t;
+			out[e_adc] = adc_on * table[e_adc].ma / t;
+			out[e_wdt] = wdt_on * table[e_wdt].ma / t;
+			out[e_led] = led * table[e_led].ma / t;
+			out[e_rtc_active] = rtc_active * table[e_rtc_active].ma / t;
+			out[e_rtc_standby] = (t - rtc_active) * table[e_rtc_standby].ma / t;
+			out[e_hc595] = table[e_hc595].ma;
+			out[e_bod] = table[e_bod].ma;
+		}
+
+		double ma() const {
+			double c[ENTRIES];
+			currents(c);
+			double sum = 0;
+			for(double x : c)
+				sum += x;
+			return sum;
+		}
+	};
+
+	class model {
+	public:
+		explicit model(const config &c) : cfg(c) {
+			modes.push_back(totals());
+			modes.back().name = "all";
+		}
+
+		//false for a record going back in time.
+		bool advance(uint64_t cycle) {
+			if(started && cycle < last_cycle)
+				return false;
+			if(started) {
+				const double dt = (cycle - last_cycle) / cfg.fcpu;
+				totals &m = modes[current];
+				m.cpu[cpu] += dt;
+				if(aden && !pradc)
+					m.adc_on += dt;
+				if(wdt)
+					m.wdt_on += dt;
+				if(port & bv(cfg.ce))
+					m.rtc_active += dt;
+				m.led += dt * lit;
+				for(int b = 0; b != 8; ++b) {
+					if(!(code & (1u << b)))
+						m.segment[b] += dt * digits;
+				}
+			}
+			started = true;
+			last_cycle = cycle;
+			return true;
+		}
+
+		void on_port(uint8_t p) {
+			const uint8_t rise = static_cast<uint8_t>(~port & p);
+			//SCLK and RCLK rising in the same write: the shift goes first, as in a 595 with tied clocks.
+			if(rise & bv(cfg.sclk))
+				shift = static_cast<uint16_t>((shift >> 1) | ((p & bv(cfg.ds)) ? 0x8000 : 0));
+			if(rise & bv(cfg.ce))
+				latch();
+			port = p;
+		}
+
+		void on_sleep(cpu_state s) {
+			cpu = s;
+		}
+
+		void on_wake() {
+			cpu = cpu_active;
+		}
+
+		void on_adcsra(uint8_t v) {
+			aden = v & 0x80;
+		}
+
+		void on_prr(uint8_t v) {
+			pradc = v & 0x01;
+		}
+
+		void on_wdtcr(uint8_t v) {
+			wdt = v & 0x48;    //WDTIE | WDE
+		}
+
+		void on_mode(const std::string &name) {
+			//time before the first mode record is dropped with the "all" placeholder.
+			if(!named) {
+				named = true;
+				modes.clear();
+			}
+			for(size_t i = 0; i != modes.size(); ++i) {
+				if(modes[i].name == name) {
+					current = i;
+					return;
+				}
+			}
+			modes.push_back(totals());
+			modes.back().name = name;
+			current = modes.size() - 1;
+		}
+
+		const std::vector<totals> &result() const {
+			return modes;
+		}
+
+	private:
+		static uint8_t bv(uint8_t b) {
+			return static_cast<uint8_t>(1u << b);
+		}
+
+		static unsigned ones(uint8_t v) {
+			unsigned n = 0;
+			for(; v; v &= v - 1)
+				++n;
+			return n;
+		}
+
+		//first byte shifted (segment code) in the low half, LSB first.
+		void latch() {
+			code = static_cast<uint8_t>(shift);
+			digits = ones(static_cast<uint8_t>(shift >> 8));
+			lit = ones(static_cast<uint8_t>(~code)) * digits;
+			if(!modes.empty() && lit > modes[current].peak)
+				modes[current].peak = lit;
+		}
+
+		const config &cfg;
+
+		bool started = false;
+		uint64_t last_cycle = 0;
+
+		uint8_t port = 0;
+		uint16_t shift = 0;
+		uint8_t code = 0xff;
+		unsigned digits = 0;
+		unsigned lit = 0;
+
+		cpu_state cpu = cpu_active;
+		bool aden = false;
+		bool pradc = false;
+		bool wdt = false;
+
+		bool named = false;
+		std::vector<totals> modes;
+		size_t current = 0;
+	};
+
+	bool parse_hex(const std::string &s, uint8_t &out) {
+		char *end;
+		unsigned long v = strtoul(s.c_str(), &end, 16);
+		if(s.empty() || *end || v > 0xff)
+			return false;
+		out = static_cast<uint8_t>(v);
+		return true;
+	}
+
+	//false for a malformed record, blank and comment lines are fine.
+	bool feed(model &m, const std::string &line) {
+		std::istringstream ls(line.substr(0, line.find('#')));
+		std::string cyc, what, arg;
+		if(!(ls >> cyc))
+			return true;
+		if(!(ls >> what))
+			return false;
+		ls >> arg;
+
+		char *end;
+		uint64_t cycle = strtoull(cyc.c_str(), &end, 10);
+		if(*end || !m.advance(cycle))
+			return false;
+
+		uint8_t v;
+		if(what == "sleep") {
+			if(arg == "idle")
+				m.on_sleep(cpu_idle);
+			else if(arg == "adc")
+				m.on_sleep(cpu_adc);
+			else if(arg == "pdown")
+				m.on_sleep(cpu_pdown);
+			else
+				return false;
+		}
+		else if(what == "wake") {
+			m.on_wake();
+		}
+		else if(what == "mode") {
+			if(arg.empty())
+				return false;
+			m.on_mode(arg);
+		}
+		else if(what == "ADCSRA" || what == "PRR" || what == "WDTCR") {
+			if(!parse_hex(arg, v))
+				return false;
+			if(what == "ADCSRA")
+				m.on_adcsra(v);
+			else if(what == "PRR")
+				m.on_prr(v);
+			else
+				m.on_wdtcr(v);
+		}
+		else {
+			if(!parse_hex(what, v))
+				return false;
+			m.on_port(v);
+		}
+		return true;
+	}
+
+	bool set_entry(const char *arg) {
+		const char *eq = strchr(arg, '=');
+		if(!eq)
+			return false;
+		std::string name(arg, eq);
+		for(entry &e : table) {
+			if(name == e.name) {
+				e.ma = atof(eq + 1);
+				return e.ma >= 0;
+			}
+		}
+		return false;
+	}
+
+	void list() {
+		for(const entry &e : table)
+			printf("%-12s %9.4f mA  %s\n", e.name, e.ma, e.what);
+	}
+
+	void report(const totals &m) {
+		const double t = m.time();
+		printf("== %s, %.3f s\n", m.name.c_str(), t);
+		if(t <= 0)
+			return;
+
+		printf("   cpu      ");
+		for(int s = 0; s != CPU_STATES; ++s)
+			printf(" %s %.1f%%", cpu_names[s], 100 * m.cpu[s] / t);
+		printf("\n   on        ADC %.1f%%  watchdog %.1f%%  DS1302 %.2f%%\n",
+		       100 * m.adc_on / t, 100 * m.wdt_on / t, 100 * m.rtc_active / t);
+
+		//mean duty of the 4 LEDs of each segment line.
+		printf("   leds      %.2f lit on average, %u at most\n   segments ", m.led / t, m.peak);
+		for(int b = 7; b >= 0; --b)
+			printf(" %s %.1f%%", segment_names[b], 100 * m.segment[b] / (4 * t));
+
+		double c[ENTRIES];
+		m.currents(c);
+		printf("\n   mA       ");
+		for(int e = 0; e != ENTRIES; ++e) {
+			if(c[e] > 0)
+				printf(" %s %.4f", table[e].name, c[e]);
+		}
+		printf("\n   average   %.3f mA\n", m.ma());
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: energy [--fcpu HZ] [--set NAME=MA]... [--list] [--sclk N] [--ce N] [--ds N] trace.txt\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	config cfg;
+	const char *trace_path = nullptr;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--fcpu") && has_arg)
+			cfg.fcpu = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--set") && has_arg) {
+			if(!set_entry(argv[++i])) {
+				fprintf(stderr, "energy: bad table entry %s, see --list\n", argv[i]);
+				return 255;
+			}
+		}
+		else if(!strcmp(argv[i], "--list")) {
+			list();
+			return 0;
+		}
+		else if(!strcmp(argv[i], "--sclk") && has_arg)
+			cfg.sclk = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--ce") && has_arg)
+			cfg.ce = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--ds") && has_arg)
+			cfg.ds = static_cast<uint8_t>(atoi(argv[++i]));
+		else if(argv[i][0] != '-' && !trace_path)
+			trace_path = argv[i];
+		else {
+			usage();
+			return 255;
+		}
+	}
+	if(!trace_path || cfg.fcpu <= 0) {
+		usage();
+		return 255;
+	}
+
+	std::ifstream in(trace_path);
+	if(!in) {
+		fprintf(stderr, "energy: cannot read trace %s\n", trace_path);
+		return 255;
+	}
+
+	model m(cfg);
+	std::string line;
+	unsigned n = 0;
+	while(std::getline(in, line)) {
+		++n;
+		if(!feed(m, line)) {
+			fprintf(stderr, "energy: bad record at line %u: %s\n", n, line.c_str());
+			return 255;
+		}
+	}
+
+	double t = 0, charge = 0;
+	for(const totals &mode : m.result()) {
+		report(mode);
+		if(mode.time() > 0) {
+			t += mode.time();
+			charge += mode.time() * mode.ma();
+		}
+	}
+	if(t > 0)
+		printf("trace: %.3f s, %.3f mA on average, %.4f mAh\n", t, charge / t, charge / 3600);
+	return 0;
+}
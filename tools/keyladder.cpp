@@ -0,0 +1,174 @@
+/* keyladder - runs the firmware's resistor ladder key decoder (key_ladder in main.cpp) over every ADC code,
+*  through the same find() / near_threshold() / decode() the firmware calls, and over resistor tolerances.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o keyladder keyladder.cpp
+*
+*  usage:
+*      keyladder [options]
+*
+*      --tolerance PCT  resistor tolerance for the single key check, default 5.
+*      -v               print the decoded level of every code.
+*
+*  the decoder is aaz::ladder::decoder from the firmware headers, instantiated as key_ladder in main.cpp,
+*  the compile-time sweep there checks the linear level_of(), this one the binary search used at run time.
+*  checks, each failure is printed:
+*      - every code 0 - 255 decodes to the level with the nearest expected code (the upper one on a tie).
+*      - near_threshold() is true exactly for codes within the guard band around a threshold of their level.
+*      - decode() (compares against immediates for a few levels) gives the mask of the level find() gives.
+*      - no key decodes to mask 0, each single key to its own bit.
+*      - each key alone, with the pull-up and its resistor anywhere in the tolerance, reads as that key,
+*        and inside its band of the fixed thresholds before the ladder decoder (62 / 124 / 185),
+*        so a board fitted with these values works with either firmware.
+*
+*  exit status is the number of failures (capped at 255), 0 when the decoder passes.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../seg7-595-leddrv/aaz/ladder.h"
+
+namespace {
+	//same as key_ladder in main.cpp: 8-bit readings, 24 codes apart, 10k pull-up, keys A 15k, B 5.6k, T 1.3k.
+	typedef aaz::ladder::decoder<8, 24, 10000, 15000, 5600, 1300> ladder;
+	const double R_UP = 10000;
+	const double R_KEY[] = {15000, 5600, 1300};
+	const char key_names[] = {'A', 'B', 'T'};
+	//[low, high) codes of each key with the fixed thresholds before the ladder decoder, the hardware contract of older boards.
+	const unsigned OLD_BAND[][2] = {{124, 185}, {62, 124}, {0, 62}};
+	const unsigned KEYS = sizeof(R_KEY) / sizeof(R_KEY[0]);
+
+	unsigned failures = 0;
+
+	unsigned dist(unsigned a, unsigned b) {
+		return a > b ? a - b : b - a;
+	}
+
+	unsigned nearest(unsigned r) {
+		unsigned best = 0;
+		for(unsigned l = 1; l != ladder::levels; ++l) {
+			if(dist(r, ladder::table::code[l]) <= dist(r, ladder::table::code[best]))
+				best = l;
+		}
+		return best;
+	}
+
+	bool in_guard(unsigned r, unsigned level) {
+		if(level > 0 && r - ladder::table::th[level - 1] < ladder::guard)
+			return true;
+		if(level < ladder::levels - 1u && ladder::table::th[level] - r <= ladder::guard)
+			return true;
+		return false;
+	}
+
+	void check_codes(bool verbose) {
+		for(unsigned r = 0; r != 256; ++r) {
+			uint8_t level = ladder::find(static_cast<uint8_t>(r));
+			bool near = ladder::near_threshold(static_cast<uint8_t>(r), level);
+			if(verbose)
+				printf("code %3u: level %u mask 0x%02x%s\n", r, level, ladder::mask_at(level), near ? " near" : "");
+			if(level != nearest(r)) {
+				printf("  FAIL: code %u decodes to level %u, nearest is %u\n", r, level, nearest(r));
+				++failures;
+			}
+			if(near != in_guard(r, level)) {
+				printf("  FAIL: code %u near_threshold %d, guard band says %d\n", r, near, !near);
+				++failures;
+			}
+			if(ladder::decode(static_cast<uint8_t>(r)) != ladder::mask_at(level)) {
+				printf("  FAIL: code %u decode() gives mask 0x%02x, find() level %u has 0x%02x\n",
+				       r, ladder::decode(static_cast<uint8_t>(r)), level, ladder::mask_at(level));
+				++failures;
+			}
+		}
+	}
+
+	void check_masks() {
+		if(ladder::mask_at(ladder::levels - 1) != 0) {
+			printf("  FAIL: no key (top level) has mask 0x%02x\n", ladder::mask_at(ladder::levels - 1));
+			++failures;
+		}
+		for(unsigned k = 0; k != KEYS; ++k) {
+			uint8_t code = static_cast<uint8_t>(256 * R_KEY[k] / (R_KEY[k] + R_UP));
+			uint8_t m = ladder::decode(code);
+			if(m != (1u << k)) {
+				printf("  FAIL: key %c alone (code %u) decodes to mask 0x%02x\n", key_names[k], code, m);
+				++failures;
+			}
+		}
+	}
+
+	//ADC code of a key with resistors off by fk and fu (1.0 is nominal), truncated as the ADC does.
+	uint8_t code_of(unsigned k, double fk, double fu) {
+		double c = 256 * R_KEY[k] * fk / (R_KEY[k] * fk + R_UP * fu);
+		return c > 255 ? 255 : static_cast<uint8_t>(c);
+	}
+
+	void check_tolerance(double pct) {
+		const double lo = 1 - pct / 100, hi = 1 + pct / 100;
+		for(unsigned k = 0; k != KEYS; ++k) {
+			unsigned cmin = 255, cmax = 0;
+			const double f[][2] = {{lo, lo}, {lo, hi}, {hi, lo}, {hi, hi}, {1, 1}};
+			for(const auto &ff : f) {
+				uint8_t c = code_of(k, ff[0], ff[1]);
+				cmin = c < cmin ? c : cmin;
+				cmax = c > cmax ? c : cmax;
+			}
+			//every code in between as well.
+			for(unsigned c = cmin; c <= cmax; ++c) {
+				uint8_t level = ladder::find(static_cast<uint8_t>(c));
+				if(ladder::mask_at(level) != (1u << k)) {
+					printf("  FAIL: key %c at code %u (%.0f%% resistors) decodes to mask 0x%02x\n", key_names[k], c, pct,
+					       ladder::mask_at(level));
+					++failures;
+				}
+				if(c < OLD_BAND[k][0] || c >= OLD_BAND[k][1]) {
+					printf("  FAIL: key %c at code %u (%.0f%% resistors) is out of its old band %u - %u\n", key_names[k], c, pct,
+					       OLD_BAND[k][0], OLD_BAND[k][1] - 1);
+					++failures;
+				}
+			}
+			printf("key %c: codes %u - %u with %.0f%% resistors\n", key_names[k], cmin, cmax, pct);
+		}
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: keyladder [--tolerance PCT] [-v]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	double tolerance = 5;
+	bool verbose = false;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--tolerance") && has_arg)
+			tolerance = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-v"))
+			verbose = true;
+		else {
+			usage();
+			return 255;
+		}
+	}
+
+	printf("%u levels, guard %u:", ladder::levels, ladder::guard);
+	for(unsigned l = 0; l != ladder::levels; ++l) {
+		printf(" [code %u mask 0x%02x]", ladder::table::code[l], ladder::mask_at(l));
+		if(l != ladder::levels - 1u)
+			printf(" < %u <", ladder::table::th[l]);
+	}
+	printf("\n");
+
+	check_codes(verbose);
+	check_masks();
+	check_tolerance(tolerance);
+
+	if(failures)
+		fprintf(stderr, "keyladder: %u failures\n", failures);
+	return failures > 255 ? 255 : static_cast<int>(failures);
+}
@@ -0,0 +1,185 @@
+/* lightcurve - runs the firmware's ambient light filter and level curve (CLK_LIGHT) over every reading
+*  and over simulated noisy light.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o lightcurve lightcurve.cpp
+*
+*  usage:
+*      lightcurve [options]
+*
+*      --noise N        peak noise in ticks added to each charge time, default 1 (the count is whole ticks).
+*      --samples N      measurements per simulated light value, default 200 (one each 2s).
+*      -v               print the level bands and every level change.
+*
+*  the filter and curve are aaz::ambient::lpf and aaz::ambient::curve from the firmware headers,
+*  instantiated as light_filter and light_curve in main.cpp.
+*  checks, each failure is printed:
+*      - a level moves one step at most per reading.
+*      - no flicker: a reading which moves the level up (or down) never moves it back at the next step,
+*        each threshold has a dead band of one code at least.
+*      - the filter settles on a constant reading exactly, reaches 63% of a step within 2^Shift readings,
+*        and never overshoots (one code of rounding allowed).
+*      - a constant light with noise, held at every charge time 0 - 255, changes the level
+*        no more than once after the filter settled.
+*
+*  exit status is the number of failures (capped at 255), 0 when the curve passes.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../seg7-595-leddrv/aaz/ambient.h"
+
+namespace {
+	//same as light_curve and light_filter in main.cpp.
+	typedef aaz::ambient::curve<2, 3, 12, 48> curve;
+	const uint8_t FILTER_SHIFT = 2;
+	typedef aaz::ambient::lpf<FILTER_SHIFT> filter;
+
+	struct config {
+		unsigned noise = 1;
+		unsigned samples = 200;
+		bool verbose = false;
+	};
+
+	unsigned failures = 0;
+
+	//deterministic noise, the same run gives the same result.
+	uint32_t rng = 12345;
+
+	int noise(unsigned peak) {
+		rng = rng * 1103515245u + 12345u;
+		return peak ? static_cast<int>((rng >> 8) % (2 * peak + 1)) - static_cast<int>(peak) : 0;
+	}
+
+	//charge time as light_step() counts it, saturated at 255.
+	uint8_t reading(int ticks) {
+		return ticks < 0 ? 0 : ticks > 255 ? 255 : static_cast<uint8_t>(ticks);
+	}
+
+	void check_curve(bool verbose) {
+		for(uint8_t level = 0; level != curve::levels; ++level) {
+			int lo = -1, hi = -1;
+			for(unsigned x = 0; x != 256; ++x) {
+				uint8_t n = curve::next(level, static_cast<uint8_t>(x));
+				if(n >= curve::levels || (n != level && n + 1 != level && n != level + 1)) {
+					printf("  FAIL: level %u -> %u at %u, more than one step\n", level, n, x);
+					++failures;
+					continue;
+				}
+				if(n == level) {
+					if(lo < 0)
+						lo = static_cast<int>(x);
+					hi = static_cast<int>(x);
+				}
+				else if(curve::next(n, static_cast<uint8_t>(x)) == level) {
+					printf("  FAIL: level %u -> %u -> %u at %u, flicker\n", level, n, curve::next(n, static_cast<uint8_t>(x)), x);
+					++failures;
+				}
+			}
+			if(verbose)
+				printf("level %u stays for readings %d - %d\n", level, lo, hi);
+		}
+	}
+
+	void check_filter() {
+		for(unsigned x = 0; x != 256; ++x) {
+			filter f;
+			f.reset(0);
+			uint8_t y = 0;
+			unsigned i = 0;
+			bool reached = false;
+			for(; i != 64; ++i) {
+				y = f.update(static_cast<uint8_t>(x));
+				if(y > x) {
+					printf("  FAIL: filter overshoots, %u on a step to %u\n", y, x);
+					++failures;
+					break;
+				}
+				if(i + 1 == (1u << FILTER_SHIFT) && y * 100u + 100 < x * 63) {
+					printf("  FAIL: filter at %u after %u readings of %u, below 63%%\n", y, i + 1, x);
+					++failures;
+				}
+				if(y == x) {
+					reached = true;
+					break;
+				}
+			}
+			if(!reached) {
+				printf("  FAIL: filter settles at %u on a constant %u\n", y, x);
+				++failures;
+			}
+		}
+	}
+
+	void check_noisy(const config &cfg) {
+		//the filter passes noise of a fraction of a code and more, the dead band has to take the rest.
+		unsigned worst = 0, worst_at = 0;
+		for(unsigned t = 0; t != 256; ++t) {
+			filter f;
+			f.reset(reading(static_cast<int>(t)));
+			uint8_t level = 0;
+			//settle from wherever the level was.
+			for(unsigned i = 0; i != 2 * curve::levels; ++i)
+				level = curve::next(level, f.update(reading(static_cast<int>(t))));
+
+			unsigned changes = 0;
+			for(unsigned i = 0; i != cfg.samples; ++i) {
+				uint8_t n = curve::next(level, f.update(reading(static_cast<int>(t) + noise(cfg.noise))));
+				if(n != level) {
+					++changes;
+					if(cfg.verbose)
+						printf("charge %3u ticks, sample %3u: level %u -> %u\n", t, i, level, n);
+				}
+				level = n;
+			}
+			if(changes > worst) {
+				worst = changes;
+				worst_at = t;
+			}
+			if(changes > 1) {
+				printf("  FAIL: %u level changes at a constant %u ticks, noise %u\n", changes, t, cfg.noise);
+				++failures;
+			}
+		}
+		printf("noise %u: at most %u level changes per constant light (at %u ticks)\n", cfg.noise, worst, worst_at);
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: lightcurve [--noise N] [--samples N] [-v]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	config cfg;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--noise") && has_arg)
+			cfg.noise = static_cast<unsigned>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--samples") && has_arg)
+			cfg.samples = static_cast<unsigned>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "-v"))
+			cfg.verbose = true;
+		else {
+			usage();
+			return 255;
+		}
+	}
+
+	printf("thresholds:");
+	for(uint8_t k = 0; k != curve::levels - 1; ++k)
+		printf(" %u (up at %u, down below %u)", curve::th[k], curve::th[k] + curve::margin(curve::th[k]),
+		       curve::th[k] - curve::margin(curve::th[k]));
+	printf("\n");
+
+	check_curve(cfg.verbose);
+	check_filter();
+	check_noisy(cfg);
+
+	if(failures)
+		fprintf(stderr, "lightcurve: %u failures\n", failures);
+	return failures > 255 ? 255 : static_cast<int>(failures);
+}
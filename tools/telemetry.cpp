@@ -0,0 +1,206 @@
+/* telemetry - decoder for the clock's binary telemetry records (firmware built with CLK_TELEMETRY=1).
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o telemetry telemetry.cpp
+*
+*  usage:
+*      telemetry [options] [capture.bin]
+*
+*      --sync-ticks N   soft timer ticks expected between two stats records, default 3662
+*                       (SYNC_TICKS, 6.25s of 1.7ms ticks), used to report lost ticks.
+*      --prescale N     cpu cycles per timer0 tick for profiling records, default 8.
+*
+*  reads raw bytes from the file, or from stdin when no file is given, e.g. straight from a serial port:
+*      stty -F /dev/ttyUSB0 4800 raw && telemetry < /dev/ttyUSB0
+*  PB1 sends 8N1 at 4839 baud (4800 +0.8%), a 4800 baud receiver takes it fine.
+*
+*  record format, see namespace telemetry in main.cpp:
+*      0xa5, type, payload..., checksum (8-bit sum of type and payload)
+*  bytes out of a record or records with a bad checksum are skipped up to the next 0xa5.
+*
+*  exit status is the number of damaged records (capped at 255), 0 when the capture is clean.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+	const uint8_t SYNC_BYTE = 0xa5;
+
+	enum record_type : uint8_t {
+		rec_boot = 0x01,
+		rec_stats,
+		rec_key,
+		rec_prof,
+		rec_vcc,
+	};
+
+	//prof_section order in main.cpp.
+	const char *const section_names[] = {"display", "sync", "rtc_step", "tx_isr"};
+
+	//payload size of each record type, 0 for unknown types.
+	size_t payload_size(uint8_t type) {
+		switch(type) {
+			case rec_boot:  return 1;
+			case rec_stats: return 10;    //sizeof(counters_t)
+			case rec_key:   return 1;
+			case rec_prof:  return 9;     //section id, aaz::prof::stat
+			case rec_vcc:   return 2;     //tier, bandgap reading
+			default:        return 0;
+		}
+	}
+
+	uint16_t le16(const uint8_t *p) {
+		return static_cast<uint16_t>(p[0] | (p[1] << 8));
+	}
+
+	uint32_t le32(const uint8_t *p) {
+		return le16(p) | (static_cast<uint32_t>(le16(p + 2)) << 16);
+	}
+
+	std::string reset_cause(uint8_t mcusr) {
+		static const char *const names[] = {"power-on", "external", "brown-out", "watchdog"};
+		std::string s;
+		for(unsigned i = 0; i != 4; ++i) {
+			if(!(mcusr & (1u << i)))
+				continue;
+			if(!s.empty())
+				s += '|';
+			s += names[i];
+		}
+		return s.empty() ? "none" : s;
+	}
+
+	const char *key_name(uint8_t code) {
+		switch(code) {
+			case 1:  return "A";
+			case 2:  return "B";
+			case 3:  return "T";
+			default: return "?";
+		}
+	}
+
+	struct config {
+		unsigned sync_ticks = 3662;
+		unsigned prescale = 8;
+	};
+
+	void print_prof(const uint8_t *p, unsigned prescale) {
+		const char *name = p[0] < sizeof(section_names) / sizeof(section_names[0]) ? section_names[p[0]] : "?";
+		uint16_t count = le16(p + 3);
+		uint32_t total = le32(p + 5);
+		printf("prof   %-8s count=%u", name, count);
+		if(count)
+			printf(" min=%u max=%u avg=%.1f cycles", p[1] * prescale, p[2] * prescale,
+			       static_cast<double>(total) * prescale / count);
+		printf("\n");
+	}
+
+	void print_record(uint8_t type, const uint8_t *p, const config &cfg) {
+		switch(type) {
+			case rec_boot:
+				printf("boot   reset=%s (MCUSR 0x%02x)\n", reset_cause(p[0]).c_str(), p[0]);
+				break;
+			case rec_stats: {
+				uint16_t ticks = le16(p + 4);
+				long lost = static_cast<long>(cfg.sync_ticks) - ticks;
+				printf("stats  syncs=%u corrections=%u keys=%u ticks=%u lost=%ld blanks=%u stack_free=%u drops=%u\n",
+				       le16(p), p[2], p[3], ticks, lost, le16(p + 6), p[8], p[9]);
+				break;
+			}
+			case rec_key:
+				printf("key    %s\n", key_name(p[0]));
+				break;
+			case rec_prof:
+				print_prof(p, cfg.prescale);
+				break;
+			case rec_vcc:
+				//reading = 1.1V * 256 / Vcc, see aaz/vcc.h.
+				printf("vcc    tier=%u reading=%u (~%umV)\n", p[0], p[1], p[1] ? 1100u * 256 / p[1] : 0);
+				break;
+		}
+	}
+
+	/* decode every complete record at the front of buf and remove it,
+	*  a damaged record only drops its sync byte, so a record starting inside it is still found.
+	*  returns true if anything was printed.
+	*/
+	bool parse(std::vector<uint8_t> &buf, const config &cfg, unsigned &damaged) {
+		bool printed = false;
+		while(true) {
+			size_t skip = 0;
+			while(skip < buf.size() && buf[skip] != SYNC_BYTE)
+				++skip;
+			buf.erase(buf.begin(), buf.begin() + skip);
+			if(buf.size() < 2)
+				return printed;
+
+			size_t n = payload_size(buf[1]);
+			if(n && buf.size() < n + 3)
+				return printed;
+
+			uint8_t sum = 0;
+			for(size_t i = 1; i < n + 2; ++i)
+				sum += buf[i];
+			if(!n || sum != buf[n + 2]) {
+				++damaged;
+				buf.erase(buf.begin());
+				continue;
+			}
+
+			print_record(buf[1], buf.data() + 2, cfg);
+			buf.erase(buf.begin(), buf.begin() + n + 3);
+			printed = true;
+		}
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: telemetry [--sync-ticks N] [--prescale N] [capture.bin]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	config cfg;
+	const char *path = nullptr;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--sync-ticks") && has_arg)
+			cfg.sync_ticks = static_cast<unsigned>(atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--prescale") && has_arg)
+			cfg.prescale = static_cast<unsigned>(atoi(argv[++i]));
+		else if(argv[i][0] != '-' && !path)
+			path = argv[i];
+		else {
+			usage();
+			return 255;
+		}
+	}
+
+	FILE *in = path ? fopen(path, "rb") : stdin;
+	if(!in) {
+		fprintf(stderr, "telemetry: cannot read %s\n", path);
+		return 255;
+	}
+
+	//records are decoded as bytes come in, so a live serial port shows them at once.
+	std::vector<uint8_t> buf;
+	unsigned damaged = 0;
+	int c;
+	while((c = fgetc(in)) != EOF) {
+		buf.push_back(static_cast<uint8_t>(c));
+		if(parse(buf, cfg, damaged))
+			fflush(stdout);
+	}
+
+	if(path)
+		fclose(in);
+	if(damaged)
+		fprintf(stderr, "telemetry: %u damaged records skipped\n", damaged);
+	return damaged > 255 ? 255 : static_cast<int>(damaged);
+}
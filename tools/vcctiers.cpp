@@ -0,0 +1,191 @@
+/* vcctiers - runs the firmware's supply tier policy (CLK_VCC) over simulated battery discharge curves.
+*
+*  host tool, build with:
+*      g++ -std=c++11 -O2 -o vcctiers vcctiers.cpp
+*
+*  usage:
+*      vcctiers [options]
+*
+*      --curve NAME     alkaline (2x AA, default), lifepo4 (1 cell, flat with a late knee) or all.
+*      --noise MV       peak noise added to each sample, default 20.
+*      --bandgap MV     actual bandgap voltage of the simulated part, default 1100 (datasheet 1000 - 1200),
+*                       the firmware always assumes 1100, so this shifts every tier.
+*      --hours N        discharge time, default 200, one sample per RTC sync (6.25s).
+*      -v               print every sample, not only tier changes.
+*
+*  the policy is aaz::vcc::tiers from the firmware headers, instantiated as vcc_tiers in main.cpp.
+*  checks, each failure is printed:
+*      - tiers only go up while the battery runs down, noise must not make them chatter.
+*      - each tier is entered within 5% below its threshold (with --bandgap 1100).
+*      - after a fresh battery is put in, tier 0 is back within one sample per tier.
+*
+*  exit status is the number of failures (capped at 255), 0 when the policy passes.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "../seg7-595-leddrv/aaz/vcc.h"
+
+namespace {
+	//same as vcc_tiers in main.cpp.
+	typedef aaz::vcc::tiers<5, 3000, 2800, 2600, 2400> policy;
+
+	const double SAMPLE_S = 6.25;
+
+	struct point {
+		double t;     //fraction of the discharge time
+		double mv;
+	};
+
+	//open circuit voltage under the clock's load, piecewise linear.
+	const point alkaline[] = {
+		{0.00, 3200}, {0.05, 3000}, {0.40, 2700}, {0.75, 2450}, {0.90, 2250}, {1.00, 1800},
+	};
+
+	const point lifepo4[] = {
+		{0.00, 3450}, {0.05, 3300}, {0.85, 3200}, {0.93, 3000}, {0.97, 2700}, {1.00, 2200},
+	};
+
+	template<size_t N>
+	double voltage_at(const point (&c)[N], double t) {
+		for(size_t i = 1; i != N; ++i) {
+			if(t <= c[i].t) {
+				double f = (t - c[i - 1].t) / (c[i].t - c[i - 1].t);
+				return c[i - 1].mv + f * (c[i].mv - c[i - 1].mv);
+			}
+		}
+		return c[N - 1].mv;
+	}
+
+	struct config {
+		std::string curve = "alkaline";
+		double noise = 20;
+		double bandgap = 1100;
+		double hours = 200;
+		bool verbose = false;
+	};
+
+	//deterministic noise, the same run gives the same result.
+	uint32_t rng = 12345;
+
+	double noise(double peak) {
+		rng = rng * 1103515245u + 12345u;
+		double u = static_cast<double>((rng >> 8) & 0xffff) / 0xffff;
+		return (2 * u - 1) * peak;
+	}
+
+	//8-bit left aligned ADC reading of the bandgap with Vcc reference.
+	uint8_t adc_reading(double vcc_mv, double bandgap_mv) {
+		double r = bandgap_mv * 256 / vcc_mv + 0.5;
+		return r > 255 ? 255 : static_cast<uint8_t>(r);
+	}
+
+	template<size_t N>
+	unsigned run(const char *name, const point (&c)[N], const config &cfg) {
+		const unsigned samples = static_cast<unsigned>(cfg.hours * 3600 / SAMPLE_S);
+		unsigned failures = 0;
+		uint8_t tier = 0;
+		double entered[policy::levels] = {};
+
+		printf("== %s, %u samples, noise %.0fmV, bandgap %.0fmV\n", name, samples, cfg.noise, cfg.bandgap);
+		for(unsigned i = 0; i <= samples; ++i) {
+			double v = voltage_at(c, static_cast<double>(i) / samples);
+			uint8_t r = adc_reading(v + noise(cfg.noise), cfg.bandgap);
+			uint8_t next = policy::next(tier, r);
+
+			if(next != tier || cfg.verbose)
+				printf("%8.2fh  %4.0fmV  reading %3u (~%umV)  tier %u%s\n", i * SAMPLE_S / 3600, v, r,
+				       aaz::vcc::mv_of(r), next, next != tier ? " <-" : "");
+			if(next < tier) {
+				printf("  FAIL: tier %u -> %u while discharging\n", tier, next);
+				++failures;
+			}
+			if(next > tier && !entered[next])
+				entered[next] = v;
+			tier = next;
+		}
+
+		if(cfg.bandgap == 1100) {
+			for(uint8_t k = 1; k != policy::levels; ++k) {
+				double th = policy::mv[k - 1];
+				if(!entered[k]) {
+					//curves which never get that low are fine.
+					continue;
+				}
+				if(entered[k] > th || entered[k] < th * 0.95) {
+					printf("  FAIL: tier %u entered at %.0fmV, threshold %.0fmV\n", k, entered[k], th);
+					++failures;
+				}
+			}
+		}
+
+		//fresh battery, one step per sample back to tier 0.
+		uint8_t from = tier;
+		unsigned steps = 0;
+		while(tier && steps <= policy::levels) {
+			tier = policy::next(tier, adc_reading(c[0].mv + noise(cfg.noise), cfg.bandgap));
+			++steps;
+		}
+		printf("  fresh battery: tier %u -> %u in %u samples\n", from, tier, steps);
+		if(tier) {
+			printf("  FAIL: tier %u after a fresh battery\n", tier);
+			++failures;
+		}
+		return failures;
+	}
+
+	void usage() {
+		fprintf(stderr, "usage: vcctiers [--curve alkaline|lifepo4|all] [--noise MV] [--bandgap MV] [--hours N] [-v]\n");
+	}
+}
+
+int main(int argc, char **argv) {
+	config cfg;
+
+	for(int i = 1; i < argc; ++i) {
+		const bool has_arg = i + 1 < argc;
+		if(!strcmp(argv[i], "--curve") && has_arg)
+			cfg.curve = argv[++i];
+		else if(!strcmp(argv[i], "--noise") && has_arg)
+			cfg.noise = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--bandgap") && has_arg)
+			cfg.bandgap = atof(argv[++i]);
+		else if(!strcmp(argv[i], "--hours") && has_arg)
+			cfg.hours = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-v"))
+			cfg.verbose = true;
+		else {
+			usage();
+			return 255;
+		}
+	}
+
+	printf("tiers:");
+	for(uint8_t k = 0; k != policy::levels - 1; ++k)
+		printf(" %u below %umV (reading %u)", k + 1, policy::mv[k], policy::th[k]);
+	printf("\n");
+
+	unsigned failures = 0;
+	bool known = false;
+	if(cfg.curve == "alkaline" || cfg.curve == "all") {
+		failures += run("alkaline 2xAA", alkaline, cfg);
+		known = true;
+	}
+	if(cfg.curve == "lifepo4" || cfg.curve == "all") {
+		failures += run("LiFePO4", lifepo4, cfg);
+		known = true;
+	}
+	if(!known) {
+		usage();
+		return 255;
+	}
+
+	if(failures)
+		fprintf(stderr, "vcctiers: %u failures\n", failures);
+	return failures > 255 ? 255 : static_cast<int>(failures);
+}